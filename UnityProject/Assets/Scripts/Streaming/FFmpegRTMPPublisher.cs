@@ -1,6 +1,7 @@
 using System;
 using System.Collections;
 using System.Runtime.InteropServices;
+using System.Threading;
 using UnityEngine;
 using UnityEngine.Rendering;
 
@@ -21,6 +22,96 @@ namespace Substream.Streaming
         public int FrameRate { get; private set; }
         public int Bitrate { get; private set; }
         public int KeyframeInterval { get; private set; }
+        public bool AsyncEncode { get; private set; }
+
+        /// <summary>
+        /// Frames arrive bottom-up (GPU readback); the native conversion flips them
+        /// without an extra copy. Set before Initialize.
+        /// </summary>
+        public bool FlipVertical { get; set; }
+
+        /// <summary>
+        /// Layout of submitted frames (NativeFFmpegBridge.RTMP_PIXEL_FORMAT_*). Set before Initialize.
+        /// BGRA matches D3D11/Metal readback; NV12/I420 (e.g. from a compute shader) skip the
+        /// native colour conversion and must be pushed with SendFrame(byte[]) or SendPlanes.
+        /// </summary>
+        public int PixelFormat { get; set; } = NativeFFmpegBridge.RTMP_PIXEL_FORMAT_RGBA;
+
+        /// <summary>
+        /// Let the native side lower the video bitrate when the network falls behind and
+        /// raise it back to Bitrate once it recovers. Set before Initialize. Has no effect
+        /// with encoders that cannot change bitrate while streaming (only libx264 and NVENC can).
+        /// </summary>
+        public bool AdaptiveBitrate { get; set; }
+
+        /// <summary>
+        /// Adaptive bitrate floor in kbps (0 = a quarter of Bitrate). Set before Initialize.
+        /// </summary>
+        public int MinBitrateKbps { get; set; }
+
+        /// <summary>
+        /// What the native side sheds when encoding takes longer than one frame
+        /// (NativeFFmpegBridge.RTMP_SKIP_*). Set before Initialize.
+        /// </summary>
+        public int SkipPolicy { get; set; } = NativeFFmpegBridge.RTMP_SKIP_DROP_NEWEST;
+
+        /// <summary>
+        /// Video rate control (NativeFFmpegBridge.RTMP_RATE_CONTROL_*). VBV and CBR cap bursts
+        /// on scene cuts so they fit the link. Set before Initialize.
+        /// </summary>
+        public int RateControl { get; set; } = NativeFFmpegBridge.RTMP_RATE_CONTROL_ABR;
+
+        /// <summary>
+        /// VBV buffer in milliseconds at Bitrate (0 = 1000). Smaller keeps per-frame size flatter. Set before Initialize.
+        /// </summary>
+        public int VbvBufferMs { get; set; }
+
+        /// <summary>
+        /// Video encoder threads (0 = one per core, up to 8). Set before Initialize.
+        /// </summary>
+        public int EncoderThreads { get; set; }
+
+        /// <summary>
+        /// Encoder threading model (NativeFFmpegBridge.RTMP_THREADING_*). Slice threading keeps
+        /// latency at one frame; frame threading trades latency for throughput. Set before Initialize.
+        /// </summary>
+        public int Threading { get; set; } = NativeFFmpegBridge.RTMP_THREADING_SLICE;
+
+        /// <summary>
+        /// Video codec (NativeFFmpegBridge.RTMP_VIDEO_CODEC_*). HEVC and AV1 need fewer bits for the
+        /// same quality but cost more CPU, and the ingest must accept enhanced RTMP. Set before Initialize.
+        /// </summary>
+        public int VideoCodec { get; set; } = NativeFFmpegBridge.RTMP_VIDEO_CODEC_H264;
+
+        /// <summary>
+        /// Try hardware encoders (NVENC, VAAPI, MediaCodec, VideoToolbox) before the software one.
+        /// Set before Initialize.
+        /// </summary>
+        public bool HardwareEncode { get; set; }
+
+        /// <summary>
+        /// Seconds of recent encoded stream kept in memory for SaveReplay (0 = off).
+        /// Set before Initialize.
+        /// </summary>
+        public int ReplayBufferSeconds { get; set; }
+
+        /// <summary>
+        /// Reconnect attempts per outage, with exponential backoff, before the stream fails (0 = off).
+        /// Frames keep being accepted while reconnecting; streaming resumes at the next keyframe.
+        /// Set before Initialize.
+        /// </summary>
+        public int ReconnectAttempts { get; set; }
+
+        /// <summary>
+        /// True while the link is down and the native side is reconnecting.
+        /// </summary>
+        public bool IsReconnecting => _session != IntPtr.Zero &&
+            NativeFFmpegBridge.rtmp_session_get_state(_session) == (int)NativeFFmpegBridge.RTMPState.Reconnecting;
+
+        /// <summary>
+        /// Video encoder chosen by the last Connect or ProbeVideoEncoder (e.g. "h264_nvenc", "libx264").
+        /// </summary>
+        public string VideoEncoder => _session != IntPtr.Zero ? NativeFFmpegBridge.GetVideoEncoder(_session) : string.Empty;
 
         // ==========================================
         // STATE
@@ -28,23 +119,97 @@ namespace Substream.Streaming
 
         public bool IsInitialized { get; private set; }
         public bool IsConnected { get; private set; }
+        public bool IsConnecting { get; private set; }
         public bool IsStreaming { get; private set; }
         public string LastError { get; private set; }
 
         // Statistics
-        public long BytesSent => NativeFFmpegBridge.rtmp_get_bytes_sent();
-        public int FramesSent => NativeFFmpegBridge.rtmp_get_frames_sent();
-        public int DroppedFrames => NativeFFmpegBridge.rtmp_get_dropped_frames();
+        public long BytesSent => GetStats().bytes_sent;
+        public int FramesSent => GetStats().frames_sent;
+        public int DroppedFrames => GetStats().dropped_frames;
+        public int SkippedFrames => GetStats().skipped_frames;
+
+        /// <summary>
+        /// Full native statistics snapshot (send queue depth, high water mark, drops).
+        /// </summary>
+        public NativeFFmpegBridge.RTMPStats GetStats()
+        {
+            NativeFFmpegBridge.RTMPStats stats = default;
+            if (_session != IntPtr.Zero)
+            {
+                NativeFFmpegBridge.rtmp_session_get_stats(_session, out stats);
+            }
+            return stats;
+        }
+
+        /// <summary>
+        /// True while a local recording is being written.
+        /// </summary>
+        public bool IsRecording => _session != IntPtr.Zero &&
+            NativeFFmpegBridge.rtmp_session_get_recording_state(_session) == (int)NativeFFmpegBridge.RTMPState.Connected;
+
+        /// <summary>
+        /// Statistics for the local recording (bytes written, queue, drops).
+        /// </summary>
+        public NativeFFmpegBridge.RTMPStats GetRecordingStats()
+        {
+            NativeFFmpegBridge.RTMPStats stats = default;
+            if (_session != IntPtr.Zero)
+            {
+                NativeFFmpegBridge.rtmp_session_get_recording_stats(_session, out stats);
+            }
+            return stats;
+        }
+
+        /// <summary>
+        /// Network statistics for a fan-out destination, in the order they were added.
+        /// </summary>
+        public NativeFFmpegBridge.RTMPStats GetDestinationStats(int index)
+        {
+            NativeFFmpegBridge.RTMPStats stats = default;
+            if (_session != IntPtr.Zero)
+            {
+                NativeFFmpegBridge.rtmp_session_get_destination_stats(_session, index, out stats);
+            }
+            return stats;
+        }
+
+        /// <summary>
+        /// State of a fan-out destination: follows the main stream, or Error once it failed.
+        /// </summary>
+        public NativeFFmpegBridge.RTMPState GetDestinationState(int index)
+        {
+            if (_session == IntPtr.Zero) return NativeFFmpegBridge.RTMPState.Idle;
+            return (NativeFFmpegBridge.RTMPState)NativeFFmpegBridge.rtmp_session_get_destination_state(_session, index);
+        }
+
+        /// <summary>
+        /// Statistics for a simulcast rendition, in the order they were added.
+        /// </summary>
+        public NativeFFmpegBridge.RTMPStats GetRenditionStats(int index)
+        {
+            NativeFFmpegBridge.RTMPStats stats = default;
+            if (_session != IntPtr.Zero)
+            {
+                NativeFFmpegBridge.rtmp_session_get_rendition_stats(_session, index, out stats);
+            }
+            return stats;
+        }
 
         // ==========================================
         // PRIVATE FIELDS
         // ==========================================
 
+        // Native session, one per publisher so several streams can run at once
+        private IntPtr _session;
+
         private RenderTexture _sourceTexture;
         private Texture2D _readbackTexture;
-        private byte[] _pixelBuffer;
-        private GCHandle _pixelBufferHandle;
-        private IntPtr _pixelBufferPtr;
+        // Pinned frame buffers handed to the native side without a copy. A buffer
+        // stays in use until the native release callback fires, so there is one
+        // more than the native encode ring can hold.
+        private const int PIXEL_BUFFER_COUNT = 4;
+        private PixelBuffer[] _pixelBuffers;
         
         private float[] _audioBuffer;
         private int _audioBufferSize;
@@ -54,6 +219,7 @@ namespace Substream.Streaming
         private bool _disposed;
         private bool _asyncReadbackSupported;
         private bool _warnedAboutStub;
+        private TextureFormat _readbackFormat;
 
         // ==========================================
         // INITIALIZATION
@@ -61,8 +227,9 @@ namespace Substream.Streaming
 
         /// <summary>
         /// Initialize the RTMP publisher.
+        /// With asyncEncode the native encoder runs on its own thread and sending a frame only copies it.
         /// </summary>
-        public bool Initialize(int width, int height, int fps, int bitrateKbps, int keyframeInterval = 2)
+        public bool Initialize(int width, int height, int fps, int bitrateKbps, int keyframeInterval = 2, bool asyncEncode = true)
         {
             if (IsInitialized)
             {
@@ -83,17 +250,46 @@ namespace Substream.Streaming
             FrameRate = fps;
             Bitrate = bitrateKbps;
             KeyframeInterval = keyframeInterval;
+            AsyncEncode = asyncEncode;
+
+            // Initialize native library (audio uses the defaults)
+            var config = NativeFFmpegBridge.RTMPConfig.Default;
+            config.width = width;
+            config.height = height;
+            config.fps = fps;
+            config.bitrate_kbps = bitrateKbps;
+            config.keyframe_interval = keyframeInterval;
+            config.async_encode = asyncEncode ? 1 : 0;
+            config.flip_vertical = FlipVertical ? 1 : 0;
+            config.pixel_format = PixelFormat;
+            config.adaptive_bitrate = AdaptiveBitrate ? 1 : 0;
+            config.min_bitrate_kbps = MinBitrateKbps;
+            config.skip_policy = SkipPolicy;
+            config.rate_control = RateControl;
+            config.vbv_buffer_ms = VbvBufferMs;
+            config.encoder_threads = EncoderThreads;
+            config.threading = Threading;
+            config.video_codec = VideoCodec;
+            config.hardware_encode = HardwareEncode ? 1 : 0;
+            config.replay_buffer_seconds = ReplayBufferSeconds;
+            config.reconnect_attempts = ReconnectAttempts;
+
+            _session = NativeFFmpegBridge.rtmp_session_create();
+            if (_session == IntPtr.Zero)
+            {
+                LastError = "Failed to create native session";
+                Debug.LogError($"[FFmpegRTMP] {LastError}");
+                return false;
+            }
 
-            // Initialize native library
-            int result = NativeFFmpegBridge.rtmp_init_simple(
-                width, height, fps, bitrateKbps, keyframeInterval,
-                44100, 2, 128 // Audio defaults
-            );
+            int result = NativeFFmpegBridge.rtmp_session_init(_session, ref config);
 
             if (result != NativeFFmpegBridge.RTMP_SUCCESS)
             {
-                LastError = NativeFFmpegBridge.GetError();
+                LastError = NativeFFmpegBridge.GetError(_session);
                 Debug.LogError($"[FFmpegRTMP] Init failed: {LastError}");
+                NativeFFmpegBridge.rtmp_session_destroy(_session);
+                _session = IntPtr.Zero;
                 return false;
             }
             
@@ -103,17 +299,21 @@ namespace Substream.Streaming
             }
 
             // Create readback texture for GPU -> CPU transfer
-            _readbackTexture = new Texture2D(width, height, TextureFormat.RGBA32, false);
+            _readbackFormat = GetReadbackFormat(PixelFormat);
+            _readbackTexture = new Texture2D(width, height, _readbackFormat, false);
             
-            // Allocate pixel buffer and pin it
-            _pixelBuffer = new byte[width * height * 4];
-            _pixelBufferHandle = GCHandle.Alloc(_pixelBuffer, GCHandleType.Pinned);
-            _pixelBufferPtr = _pixelBufferHandle.AddrOfPinnedObject();
+            // Allocate pixel buffers and pin them
+            int frameSize = NativeFFmpegBridge.GetFrameSize(PixelFormat, width, height);
+            _pixelBuffers = new PixelBuffer[PIXEL_BUFFER_COUNT];
+            for (int i = 0; i < _pixelBuffers.Length; i++)
+            {
+                _pixelBuffers[i] = new PixelBuffer(frameSize);
+            }
 
             // Check async readback support
             _asyncReadbackSupported = SystemInfo.supportsAsyncGPUReadback;
             
-            Debug.Log($"[FFmpegRTMP] Initialized: {width}x{height} @ {fps}fps, {bitrateKbps}kbps");
+            Debug.Log($"[FFmpegRTMP] Initialized: {width}x{height} @ {fps}fps, {bitrateKbps}kbps, {(asyncEncode ? "async" : "sync")} encode");
             Debug.Log($"[FFmpegRTMP] Async GPU readback: {(_asyncReadbackSupported ? "supported" : "not supported")}");
 
             IsInitialized = true;
@@ -152,32 +352,116 @@ namespace Substream.Streaming
 
             Debug.Log($"[FFmpegRTMP] Connecting to: {rtmpUrl.Substring(0, Math.Min(50, rtmpUrl.Length))}...");
 
-            int result = NativeFFmpegBridge.rtmp_connect(rtmpUrl);
+            int result = NativeFFmpegBridge.rtmp_session_connect(_session, rtmpUrl);
+            if (result != NativeFFmpegBridge.RTMP_SUCCESS)
+            {
+                LastError = NativeFFmpegBridge.GetError(_session);
+                Debug.LogError($"[FFmpegRTMP] Connect failed: {LastError}");
+                return false;
+            }
+
+            OnConnected();
+            return true;
+        }
+
+        /// <summary>
+        /// Start connecting in the background and return immediately, so the main thread never
+        /// waits on DNS, TLS or the RTMP handshake. Call PollConnect each frame until it returns true.
+        /// </summary>
+        public bool ConnectAsync(string rtmpUrl)
+        {
+            if (!IsInitialized)
+            {
+                LastError = "Not initialized";
+                return false;
+            }
+
+            if (IsConnected || IsConnecting)
+            {
+                Debug.LogWarning("[FFmpegRTMP] Already connected or connecting");
+                return true;
+            }
+
+            Debug.Log($"[FFmpegRTMP] Connecting in background to: {rtmpUrl.Substring(0, Math.Min(50, rtmpUrl.Length))}...");
+
+            int result = NativeFFmpegBridge.rtmp_session_connect_async(_session, rtmpUrl);
             if (result != NativeFFmpegBridge.RTMP_SUCCESS)
             {
-                LastError = NativeFFmpegBridge.GetError();
+                LastError = NativeFFmpegBridge.GetError(_session);
                 Debug.LogError($"[FFmpegRTMP] Connect failed: {LastError}");
                 return false;
             }
 
+            IsConnecting = true;
+            return true;
+        }
+
+        /// <summary>
+        /// Check on a ConnectAsync. Returns true once connected; false while connecting or after
+        /// a failure (IsConnecting turns false and LastError is set).
+        /// </summary>
+        public bool PollConnect()
+        {
+            if (IsConnected) return true;
+            if (!IsConnecting) return false;
+
+            var state = (NativeFFmpegBridge.RTMPState)NativeFFmpegBridge.rtmp_session_get_state(_session);
+            if (state == NativeFFmpegBridge.RTMPState.Connecting) return false;
+
+            IsConnecting = false;
+            if (state != NativeFFmpegBridge.RTMPState.Connected)
+            {
+                LastError = NativeFFmpegBridge.GetError(_session);
+                Debug.LogError($"[FFmpegRTMP] Connect failed: {LastError}");
+                return false;
+            }
+
+            OnConnected();
+            return true;
+        }
+
+        private void OnConnected()
+        {
             IsConnected = true;
             
             // Diagnostic: Check if stub library is being used
-            int state = NativeFFmpegBridge.rtmp_get_state();
+            int state = NativeFFmpegBridge.rtmp_session_get_state(_session);
             Debug.Log($"[FFmpegRTMP] Connected successfully. Native state: {state}");
+
+            var stats = GetStats();
+            if (stats.encoder_hardware != 0)
+            {
+                Debug.Log($"[FFmpegRTMP] Video encoder: {VideoEncoder} (hardware)");
+            }
+            else
+            {
+                string threadingModel = stats.encoder_threading == NativeFFmpegBridge.RTMP_THREADING_FRAME ? "frame" : "slice";
+                Debug.Log($"[FFmpegRTMP] Video encoder: {VideoEncoder}, {stats.encoder_threads} {threadingModel} thread(s)");
+            }
+            if (HardwareEncode)
+            {
+                Debug.Log($"[FFmpegRTMP] Encoder probe: {NativeFFmpegBridge.GetEncoderProbe(_session)}");
+            }
+
             if (NativeFFmpegBridge.IsStubLibrary(out string buildInfo))
             {
                 LogStubWarning("connect", buildInfo);
             }
-            
-            return true;
         }
 
         /// <summary>
-        /// Disconnect from server.
+        /// Disconnect from server. Also cancels a ConnectAsync in progress.
         /// </summary>
         public void Disconnect()
         {
+            if (IsConnecting)
+            {
+                NativeFFmpegBridge.rtmp_session_disconnect(_session);
+                IsConnecting = false;
+                Debug.Log("[FFmpegRTMP] Connect cancelled");
+                return;
+            }
+
             if (!IsConnected) return;
 
             if (IsStreaming)
@@ -185,7 +469,7 @@ namespace Substream.Streaming
                 StopStreaming();
             }
 
-            NativeFFmpegBridge.rtmp_disconnect();
+            NativeFFmpegBridge.rtmp_session_disconnect(_session);
             IsConnected = false;
             Debug.Log("[FFmpegRTMP] Disconnected");
         }
@@ -210,10 +494,10 @@ namespace Substream.Streaming
                 return true;
             }
 
-            int result = NativeFFmpegBridge.rtmp_start_streaming();
+            int result = NativeFFmpegBridge.rtmp_session_start_streaming(_session);
             if (result != NativeFFmpegBridge.RTMP_SUCCESS)
             {
-                LastError = NativeFFmpegBridge.GetError();
+                LastError = NativeFFmpegBridge.GetError(_session);
                 Debug.LogError($"[FFmpegRTMP] Start streaming failed: {LastError}");
                 return false;
             }
@@ -226,6 +510,158 @@ namespace Substream.Streaming
             return true;
         }
 
+        /// <summary>
+        /// Change the video bitrate without reconnecting. Takes effect on the next encoded frame.
+        /// Fails while connected with an encoder other than libx264 or NVENC.
+        /// </summary>
+        public bool SetBitrate(int bitrateKbps)
+        {
+            if (!IsInitialized) return false;
+
+            int result = NativeFFmpegBridge.rtmp_session_set_video_bitrate(_session, bitrateKbps);
+            if (result != NativeFFmpegBridge.RTMP_SUCCESS)
+            {
+                LastError = NativeFFmpegBridge.GetError(_session);
+                Debug.LogWarning($"[FFmpegRTMP] Set bitrate failed: {LastError}");
+                return false;
+            }
+
+            Bitrate = bitrateKbps;
+            return true;
+        }
+
+        /// <summary>
+        /// Set a video encoder option such as preset, profile, threads or crf. Call after Initialize, before Connect.
+        /// A null value removes the option. Unknown options make Connect fail.
+        /// </summary>
+        public bool SetEncoderOption(string key, string value)
+        {
+            if (!IsInitialized) return false;
+
+            int result = NativeFFmpegBridge.rtmp_session_set_encoder_option(_session, key, value);
+            if (result != NativeFFmpegBridge.RTMP_SUCCESS)
+            {
+                LastError = NativeFFmpegBridge.GetError(_session);
+                Debug.LogWarning($"[FFmpegRTMP] Set encoder option failed: {LastError}");
+                return false;
+            }
+
+            return true;
+        }
+
+        /// <summary>
+        /// Save the last seconds of the stream to a file (e.g. .mp4) without re-encoding. Needs ReplayBufferSeconds.
+        /// Blocks while the clip is written, so long clips are best saved from a worker thread.
+        /// </summary>
+        public bool SaveReplay(string path, int seconds)
+        {
+            if (_session == IntPtr.Zero) return false;
+
+            int result = NativeFFmpegBridge.rtmp_session_save_replay(_session, path, seconds);
+            if (result != NativeFFmpegBridge.RTMP_SUCCESS)
+            {
+                LastError = NativeFFmpegBridge.GetError(_session);
+                Debug.LogWarning($"[FFmpegRTMP] Save replay failed: {LastError}");
+                return false;
+            }
+
+            return true;
+        }
+
+        /// <summary>
+        /// Record the live stream to a local .mp4, .mkv or .flv file without encoding again. Call after Connect.
+        /// </summary>
+        public bool StartRecording(string path)
+        {
+            if (!IsConnected) return false;
+
+            int result = NativeFFmpegBridge.rtmp_session_start_recording(_session, path);
+            if (result != NativeFFmpegBridge.RTMP_SUCCESS)
+            {
+                LastError = NativeFFmpegBridge.GetError(_session);
+                Debug.LogWarning($"[FFmpegRTMP] Start recording failed: {LastError}");
+                return false;
+            }
+
+            Debug.Log($"[FFmpegRTMP] Recording to {path}");
+            return true;
+        }
+
+        /// <summary>
+        /// Stop the local recording and finish the file.
+        /// </summary>
+        public void StopRecording()
+        {
+            if (_session == IntPtr.Zero) return;
+
+            NativeFFmpegBridge.rtmp_session_stop_recording(_session);
+        }
+
+        /// <summary>
+        /// Also send the encoded stream to another URL, e.g. a backup ingest, without encoding again.
+        /// Call after Initialize, before Connect. A failing destination never stops the main stream.
+        /// </summary>
+        public bool AddDestination(string rtmpUrl)
+        {
+            if (!IsInitialized) return false;
+
+            int result = NativeFFmpegBridge.rtmp_session_add_destination(_session, rtmpUrl);
+            if (result != NativeFFmpegBridge.RTMP_SUCCESS)
+            {
+                LastError = NativeFFmpegBridge.GetError(_session);
+                Debug.LogWarning($"[FFmpegRTMP] Add destination failed: {LastError}");
+                return false;
+            }
+
+            return true;
+        }
+
+        /// <summary>
+        /// Add a lower resolution simulcast output published to its own URL. Call after Initialize, before Connect.
+        /// Each rendition has its own encoder; frames are converted once and scaled down for all of them.
+        /// </summary>
+        public bool AddRendition(string rtmpUrl, int width, int height, int bitrateKbps)
+        {
+            if (!IsInitialized) return false;
+
+            int result = NativeFFmpegBridge.rtmp_session_add_rendition(_session, rtmpUrl, width, height, bitrateKbps);
+            if (result != NativeFFmpegBridge.RTMP_SUCCESS)
+            {
+                LastError = NativeFFmpegBridge.GetError(_session);
+                Debug.LogWarning($"[FFmpegRTMP] Add rendition failed: {LastError}");
+                return false;
+            }
+
+            return true;
+        }
+
+        /// <summary>
+        /// Run the encoder selection Connect would make, without connecting. Call after Initialize.
+        /// Returns the probe log: every encoder tried, in order, and why it was skipped.
+        /// </summary>
+        public string ProbeVideoEncoder()
+        {
+            if (!IsInitialized) return string.Empty;
+
+            if (NativeFFmpegBridge.rtmp_session_probe_video_encoder(_session) != NativeFFmpegBridge.RTMP_SUCCESS)
+            {
+                LastError = NativeFFmpegBridge.GetError(_session);
+                Debug.LogWarning($"[FFmpegRTMP] No video encoder opened: {LastError}");
+            }
+
+            return NativeFFmpegBridge.GetEncoderProbe(_session);
+        }
+
+        /// <summary>
+        /// Make the next encoded frame a keyframe, e.g. when a viewer joins or a clip starts.
+        /// </summary>
+        public bool RequestKeyframe()
+        {
+            if (!IsInitialized) return false;
+
+            return NativeFFmpegBridge.rtmp_session_request_keyframe(_session) == NativeFFmpegBridge.RTMP_SUCCESS;
+        }
+
         /// <summary>
         /// Stop streaming.
         /// </summary>
@@ -233,10 +669,11 @@ namespace Substream.Streaming
         {
             if (!IsStreaming) return;
 
-            NativeFFmpegBridge.rtmp_stop_streaming();
+            NativeFFmpegBridge.rtmp_session_stop_streaming(_session);
             IsStreaming = false;
             
-            Debug.Log($"[FFmpegRTMP] Streaming stopped. Sent {FramesSent} frames, {BytesSent / 1024}KB, dropped {DroppedFrames}");
+            var stats = GetStats();
+            Debug.Log($"[FFmpegRTMP] Streaming stopped. Sent {stats.frames_sent} frames, {stats.bytes_sent / 1024}KB, dropped {stats.dropped_frames}, skipped {stats.skipped_frames}");
         }
 
         /// <summary>
@@ -246,13 +683,14 @@ namespace Substream.Streaming
         public void SendFrame()
         {
             if (!IsStreaming || _sourceTexture == null) return;
+            if (!IsPackedFormat(PixelFormat)) return; // YUV frames come from SendFrame(byte[]) / SendPlanes
 
             long pts = GetTimestampMs() - _startTime;
             
             if (_asyncReadbackSupported)
             {
                 // Use async readback (non-blocking)
-                AsyncGPUReadback.Request(_sourceTexture, 0, TextureFormat.RGBA32, (request) =>
+                AsyncGPUReadback.Request(_sourceTexture, 0, _readbackFormat, (request) =>
                 {
                     if (request.hasError)
                     {
@@ -262,9 +700,11 @@ namespace Substream.Streaming
 
                     if (!IsStreaming) return;
 
-                    var data = request.GetData<byte>();
-                    data.CopyTo(_pixelBuffer);
-                    SendVideoFrame(pts);
+                    var buffer = AcquirePixelBuffer();
+                    if (buffer == null) return;
+
+                    request.GetData<byte>().CopyTo(buffer.Data);
+                    SendVideoFrame(buffer, pts);
                 });
             }
             else
@@ -275,35 +715,115 @@ namespace Substream.Streaming
                 _readbackTexture.Apply();
                 RenderTexture.active = null;
 
-                _readbackTexture.GetRawTextureData<byte>().CopyTo(_pixelBuffer);
-                SendVideoFrame(pts);
+                var buffer = AcquirePixelBuffer();
+                if (buffer == null) return;
+
+                _readbackTexture.GetRawTextureData<byte>().CopyTo(buffer.Data);
+                SendVideoFrame(buffer, pts);
             }
         }
 
         /// <summary>
-        /// Send frame from custom RGBA data.
+        /// Send frame from custom data in PixelFormat (planes back to back for NV12/I420).
         /// </summary>
         public void SendFrame(byte[] rgbaData, long ptsMs)
         {
             if (!IsStreaming) return;
             
-            if (rgbaData.Length != Width * Height * 4)
+            int expectedSize = NativeFFmpegBridge.GetFrameSize(PixelFormat, Width, Height);
+            if (rgbaData.Length != expectedSize)
             {
-                Debug.LogError($"[FFmpegRTMP] Invalid data size: expected {Width * Height * 4}, got {rgbaData.Length}");
+                Debug.LogError($"[FFmpegRTMP] Invalid data size: expected {expectedSize}, got {rgbaData.Length}");
                 return;
             }
 
-            int result = NativeFFmpegBridge.rtmp_send_video_frame(rgbaData, rgbaData.Length, ptsMs);
+            int result = NativeFFmpegBridge.rtmp_session_send_video_frame(_session, rgbaData, rgbaData.Length, ptsMs);
             if (result != NativeFFmpegBridge.RTMP_SUCCESS)
             {
-                LastError = NativeFFmpegBridge.GetError();
+                LastError = NativeFFmpegBridge.GetError(_session);
                 Debug.LogWarning($"[FFmpegRTMP] Send frame failed: {LastError}");
             }
         }
 
-        private void SendVideoFrame(long pts)
+        /// <summary>
+        /// Borrow an aligned native frame buffer to fill in place (e.g. wrapped in a
+        /// NativeArray for AsyncGPUReadback.RequestIntoNativeArray). Returns IntPtr.Zero
+        /// when the encoder is behind. Pass it to SubmitFrameBuffer or ReleaseFrameBuffer.
+        /// </summary>
+        public IntPtr AcquireFrameBuffer(out int size)
         {
-            int result = NativeFFmpegBridge.rtmp_send_video_frame(_pixelBufferPtr, _pixelBuffer.Length, pts);
+            size = 0;
+            if (_session == IntPtr.Zero) return IntPtr.Zero;
+            return NativeFFmpegBridge.rtmp_session_acquire_frame_buffer(_session, out size);
+        }
+
+        /// <summary>
+        /// Send a buffer from AcquireFrameBuffer without a copy. Do not touch it afterwards.
+        /// </summary>
+        public void SubmitFrameBuffer(IntPtr buffer, long ptsMs)
+        {
+            if (!IsStreaming)
+            {
+                ReleaseFrameBuffer(buffer);
+                return;
+            }
+
+            int result = NativeFFmpegBridge.rtmp_session_submit_frame_buffer(_session, buffer, ptsMs);
+            if (result != NativeFFmpegBridge.RTMP_SUCCESS)
+            {
+                LastError = NativeFFmpegBridge.GetError(_session);
+                Debug.LogWarning($"[FFmpegRTMP] Submit frame buffer failed: {LastError}");
+            }
+        }
+
+        /// <summary>
+        /// Return a buffer from AcquireFrameBuffer without sending it.
+        /// </summary>
+        public void ReleaseFrameBuffer(IntPtr buffer)
+        {
+            if (_session == IntPtr.Zero || buffer == IntPtr.Zero) return;
+            NativeFFmpegBridge.rtmp_session_release_frame_buffer(_session, buffer);
+        }
+
+        /// <summary>
+        /// Send a frame as separate planes in PixelFormat, e.g. Y and UV from an NV12 compute pass.
+        /// Unused planes may be IntPtr.Zero.
+        /// </summary>
+        public void SendPlanes(IntPtr plane0, int stride0, IntPtr plane1, int stride1, IntPtr plane2, int stride2, long ptsMs)
+        {
+            if (!IsStreaming) return;
+
+            int result = NativeFFmpegBridge.rtmp_session_send_video_planes(
+                _session, plane0, stride0, plane1, stride1, plane2, stride2, ptsMs);
+            if (result != NativeFFmpegBridge.RTMP_SUCCESS)
+            {
+                LastError = NativeFFmpegBridge.GetError(_session);
+                Debug.LogWarning($"[FFmpegRTMP] Send planes failed: {LastError}");
+            }
+        }
+
+        /// <summary>
+        /// Send a Width x Height region of a larger packed image, e.g. a padded
+        /// readback buffer, starting at (cropX, cropY). No repacking on the managed side.
+        /// </summary>
+        public void SendFrameRegion(IntPtr data, int stride, int cropX, int cropY, long ptsMs)
+        {
+            if (!IsStreaming) return;
+
+            int result = NativeFFmpegBridge.rtmp_session_send_video_region(
+                _session, data, stride, cropX, cropY, Width, Height, ptsMs);
+            if (result != NativeFFmpegBridge.RTMP_SUCCESS)
+            {
+                LastError = NativeFFmpegBridge.GetError(_session);
+                Debug.LogWarning($"[FFmpegRTMP] Send frame region failed: {LastError}");
+            }
+        }
+
+        // Ownership passes to the native side until the release callback fires
+        private void SendVideoFrame(PixelBuffer buffer, long pts)
+        {
+            int result = NativeFFmpegBridge.rtmp_session_submit_video_frame(
+                _session, buffer.Pointer, buffer.Data.Length, s_releasePixelBuffer, buffer.Self, pts);
             if (result != NativeFFmpegBridge.RTMP_SUCCESS)
             {
                 // Don't spam logs for occasional failures
@@ -326,13 +846,86 @@ namespace Substream.Streaming
             if (!IsStreaming) return;
 
             long pts = GetTimestampMs() - _startTime;
-            NativeFFmpegBridge.rtmp_send_audio(samples, numSamples, pts);
+            NativeFFmpegBridge.rtmp_session_send_audio(_session, samples, numSamples, pts);
+        }
+
+        // ==========================================
+        // PIXEL BUFFERS
+        // ==========================================
+
+        private sealed class PixelBuffer
+        {
+            public readonly byte[] Data;
+            public readonly IntPtr Pointer;
+            public readonly IntPtr Self;
+            public int InUse;
+
+            private GCHandle _pin;
+            private GCHandle _self;
+
+            public PixelBuffer(int size)
+            {
+                Data = new byte[size];
+                _pin = GCHandle.Alloc(Data, GCHandleType.Pinned);
+                Pointer = _pin.AddrOfPinnedObject();
+                _self = GCHandle.Alloc(this);
+                Self = GCHandle.ToIntPtr(_self);
+            }
+
+            public void Free()
+            {
+                if (_pin.IsAllocated) _pin.Free();
+                if (_self.IsAllocated) _self.Free();
+            }
+        }
+
+        // Kept in a static field so the delegate outlives every native call
+        private static readonly NativeFFmpegBridge.RTMPReleaseCallback s_releasePixelBuffer = ReleasePixelBuffer;
+
+        [AOT.MonoPInvokeCallback(typeof(NativeFFmpegBridge.RTMPReleaseCallback))]
+        private static void ReleasePixelBuffer(IntPtr opaque, IntPtr data)
+        {
+            if (GCHandle.FromIntPtr(opaque).Target is PixelBuffer buffer)
+            {
+                Interlocked.Exchange(ref buffer.InUse, 0);
+            }
+        }
+
+        // Returns a buffer the native side is not using, or null if all are queued
+        private PixelBuffer AcquirePixelBuffer()
+        {
+            foreach (var buffer in _pixelBuffers)
+            {
+                if (Interlocked.CompareExchange(ref buffer.InUse, 1, 0) == 0)
+                {
+                    return buffer;
+                }
+            }
+            return null;
         }
 
         // ==========================================
         // HELPERS
         // ==========================================
 
+        private static bool IsPackedFormat(int pixelFormat)
+        {
+            return pixelFormat == NativeFFmpegBridge.RTMP_PIXEL_FORMAT_RGBA ||
+                   pixelFormat == NativeFFmpegBridge.RTMP_PIXEL_FORMAT_BGRA ||
+                   pixelFormat == NativeFFmpegBridge.RTMP_PIXEL_FORMAT_ARGB;
+        }
+
+        // GPU readback format matching the native byte order, so no swizzle is needed
+        private static TextureFormat GetReadbackFormat(int pixelFormat)
+        {
+            switch (pixelFormat)
+            {
+                case NativeFFmpegBridge.RTMP_PIXEL_FORMAT_BGRA: return TextureFormat.BGRA32;
+                case NativeFFmpegBridge.RTMP_PIXEL_FORMAT_ARGB: return TextureFormat.ARGB32;
+                default: return TextureFormat.RGBA32;
+            }
+        }
+
         private long GetTimestampMs()
         {
             return (long)(Time.realtimeSinceStartup * 1000);
@@ -385,15 +978,21 @@ namespace Substream.Streaming
 
             Disconnect();
             
-            if (IsInitialized)
+            if (_session != IntPtr.Zero)
             {
-                NativeFFmpegBridge.rtmp_cleanup();
-                IsInitialized = false;
+                NativeFFmpegBridge.rtmp_session_destroy(_session);
+                _session = IntPtr.Zero;
             }
+            IsInitialized = false;
 
-            if (_pixelBufferHandle.IsAllocated)
+            // The session is destroyed, so every buffer has been released
+            if (_pixelBuffers != null)
             {
-                _pixelBufferHandle.Free();
+                foreach (var buffer in _pixelBuffers)
+                {
+                    buffer.Free();
+                }
+                _pixelBuffers = null;
             }
 
             if (_readbackTexture != null)
@@ -417,12 +1016,51 @@ namespace Substream.Streaming
     /// </summary>
     public class FFmpegRTMPPublisherBehaviour : MonoBehaviour
     {
+        [Serializable]
+        public class Rendition
+        {
+            public string rtmpUrl;
+            public int width = 640;
+            public int height = 360;
+            public int bitrateKbps = 800;
+        }
+
         [Header("Configuration")]
         public int width = 1280;
         public int height = 720;
         public int frameRate = 30;
         public int bitrateKbps = 3500;
         public int keyframeInterval = 2;
+        [Tooltip("Encode on a native background thread so SendFrame never waits on the encoder")]
+        public bool asyncEncode = true;
+        [Tooltip("Source rows are bottom-up; flip them in the native colour conversion")]
+        public bool flipVertical = false;
+        [Tooltip("Lower the video bitrate when the network falls behind, ramp back up when it recovers")]
+        public bool adaptiveBitrate = true;
+        [Tooltip("Adaptive bitrate floor in kbps (0 = a quarter of bitrateKbps)")]
+        public int minBitrateKbps = 0;
+        [Tooltip("Frames shed when encoding is slower than the frame rate: 0 = drop newest, 1 = drop oldest, 2 = keep latest only")]
+        public int skipPolicy = NativeFFmpegBridge.RTMP_SKIP_DROP_NEWEST;
+        [Tooltip("Video rate control: 0 = average bitrate, 1 = VBV capped, 2 = strict CBR")]
+        public int rateControl = NativeFFmpegBridge.RTMP_RATE_CONTROL_ABR;
+        [Tooltip("VBV buffer in milliseconds for VBV/CBR (0 = 1000)")]
+        public int vbvBufferMs = 0;
+        [Tooltip("Video encoder threads (0 = one per core, up to 8)")]
+        public int encoderThreads = 0;
+        [Tooltip("Encoder threading: 0 = slice (lowest latency), 1 = frame (more throughput, adds delay)")]
+        public int threading = NativeFFmpegBridge.RTMP_THREADING_SLICE;
+        [Tooltip("Video codec: 0 = H.264, 1 = HEVC, 2 = AV1 (HEVC/AV1 need an enhanced RTMP ingest)")]
+        public int videoCodec = NativeFFmpegBridge.RTMP_VIDEO_CODEC_H264;
+        [Tooltip("Try hardware encoders (NVENC, VAAPI, MediaCodec, VideoToolbox) before software")]
+        public bool hardwareEncode = false;
+        [Tooltip("Seconds of recent stream kept in memory for SaveReplay (0 = off)")]
+        public int replayBufferSeconds = 0;
+        [Tooltip("Reconnect attempts per outage with backoff before the stream fails (0 = off)")]
+        public int reconnectAttempts = 5;
+        [Tooltip("Connect in the background so StartStream never stalls the frame on the handshake")]
+        public bool connectAsync = true;
+        [Tooltip("Encoder options as key=value, e.g. preset=faster, profile=high, threads=4, crf=23")]
+        public string[] encoderOptions = new string[0];
 
         [Header("Source")]
         public RenderTexture sourceTexture;
@@ -430,6 +1068,10 @@ namespace Substream.Streaming
 
         [Header("Target")]
         public string rtmpUrl;
+        [Tooltip("Extra URLs that receive the same encoded stream (up to 4), e.g. a backup ingest")]
+        public string[] extraDestinations = new string[0];
+        [Tooltip("Extra lower resolution outputs encoded from the same capture (up to 4), each to its own URL")]
+        public Rendition[] renditions = new Rendition[0];
 
         [Header("Audio")]
         public bool captureAudio = true;
@@ -439,12 +1081,17 @@ namespace Substream.Streaming
         [SerializeField] private bool _isStreaming;
         [SerializeField] private int _framesSent;
         [SerializeField] private int _droppedFrames;
+        [SerializeField] private int _skippedFrames;
         [SerializeField] private float _bitrateMbps;
+        [SerializeField] private int _targetBitrateKbps;
+        [SerializeField] private int _reconnects;
+        [SerializeField] private int _destinationsFailed;
 
         private FFmpegRTMPPublisher _publisher;
         private RenderTexture _cameraTexture;
         private AudioCapture _audioCapture;
         private float _lastStatsUpdate;
+        private bool _startWhenConnected;
 
         void Start()
         {
@@ -458,13 +1105,46 @@ namespace Substream.Streaming
 
             // Initialize publisher
             _publisher = new FFmpegRTMPPublisher();
-            if (!_publisher.Initialize(width, height, frameRate, bitrateKbps, keyframeInterval))
+            _publisher.FlipVertical = flipVertical;
+            _publisher.AdaptiveBitrate = adaptiveBitrate;
+            _publisher.MinBitrateKbps = minBitrateKbps;
+            _publisher.SkipPolicy = skipPolicy;
+            _publisher.RateControl = rateControl;
+            _publisher.VbvBufferMs = vbvBufferMs;
+            _publisher.EncoderThreads = encoderThreads;
+            _publisher.Threading = threading;
+            _publisher.VideoCodec = videoCodec;
+            _publisher.HardwareEncode = hardwareEncode;
+            _publisher.ReplayBufferSeconds = replayBufferSeconds;
+            _publisher.ReconnectAttempts = reconnectAttempts;
+            if (!_publisher.Initialize(width, height, frameRate, bitrateKbps, keyframeInterval, asyncEncode))
             {
                 Debug.LogError("[FFmpegRTMP] Failed to initialize publisher");
                 enabled = false;
                 return;
             }
 
+            foreach (string option in encoderOptions)
+            {
+                int separator = option.IndexOf('=');
+                if (separator <= 0)
+                {
+                    Debug.LogWarning($"[FFmpegRTMP] Ignoring encoder option without key=value: {option}");
+                    continue;
+                }
+                _publisher.SetEncoderOption(option.Substring(0, separator).Trim(), option.Substring(separator + 1).Trim());
+            }
+
+            foreach (string destination in extraDestinations)
+            {
+                _publisher.AddDestination(destination);
+            }
+
+            foreach (Rendition rendition in renditions)
+            {
+                _publisher.AddRendition(rendition.rtmpUrl, rendition.width, rendition.height, rendition.bitrateKbps);
+            }
+
             _publisher.SetSourceTexture(sourceTexture);
 
             // Set up audio capture
@@ -479,6 +1159,20 @@ namespace Substream.Streaming
         {
             if (_publisher == null) return;
 
+            if (_startWhenConnected)
+            {
+                if (_publisher.PollConnect())
+                {
+                    _startWhenConnected = false;
+                    _publisher.StartStreaming();
+                }
+                else if (!_publisher.IsConnecting)
+                {
+                    // Connect failed; LastError holds the reason
+                    _startWhenConnected = false;
+                }
+            }
+
             _isStreaming = _publisher.IsStreaming;
 
             if (_isStreaming)
@@ -491,7 +1185,12 @@ namespace Substream.Streaming
             {
                 _framesSent = _publisher.FramesSent;
                 _droppedFrames = _publisher.DroppedFrames;
+                _skippedFrames = _publisher.SkippedFrames;
                 _bitrateMbps = (_publisher.BytesSent * 8f) / (Time.realtimeSinceStartup * 1000000f);
+                var stats = _publisher.GetStats();
+                _targetBitrateKbps = stats.video_bitrate_kbps;
+                _reconnects = stats.reconnects;
+                _destinationsFailed = stats.destinations_failed;
                 _lastStatsUpdate = Time.time;
             }
         }
@@ -518,7 +1217,11 @@ namespace Substream.Streaming
                 return;
             }
 
-            if (_publisher.Connect(rtmpUrl))
+            if (connectAsync)
+            {
+                _startWhenConnected = _publisher.ConnectAsync(rtmpUrl);
+            }
+            else if (_publisher.Connect(rtmpUrl))
             {
                 _publisher.StartStreaming();
             }
@@ -529,9 +1232,39 @@ namespace Substream.Streaming
         /// </summary>
         public void StopStream()
         {
+            _startWhenConnected = false;
             _publisher?.Disconnect();
         }
 
+        /// <summary>
+        /// Start a new keyframe on the next frame (viewer join, highlight clip).
+        /// </summary>
+        public void RequestKeyframe()
+        {
+            _publisher?.RequestKeyframe();
+        }
+
+        /// <summary>
+        /// Record the running stream to a local .mp4, .mkv or .flv file.
+        /// </summary>
+        public bool StartRecording(string path)
+        {
+            return _publisher != null && _publisher.StartRecording(path);
+        }
+
+        public void StopRecording()
+        {
+            _publisher?.StopRecording();
+        }
+
+        /// <summary>
+        /// Save the last seconds of the stream to a clip file.
+        /// </summary>
+        public bool SaveReplay(string path, int seconds)
+        {
+            return _publisher != null && _publisher.SaveReplay(path, seconds);
+        }
+
         private void OnAudioData(float[] data, int channels)
         {
             if (_publisher != null && _publisher.IsStreaming)
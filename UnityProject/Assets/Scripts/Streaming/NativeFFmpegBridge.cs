@@ -24,6 +24,37 @@ namespace Substream.Streaming
         public const int RTMP_ERROR_NOT_CONNECTED = -5;
         public const int RTMP_ERROR_INVALID_PARAMS = -6;
         public const int RTMP_ERROR_ALLOC_FAILED = -7;
+        public const int RTMP_ERROR_NOT_SUPPORTED = -8;
+
+        // Send queue drop policies
+        public const int RTMP_DROP_NEWEST = 0;
+        public const int RTMP_DROP_QUEUED = 1;
+
+        // Encoder overload policies (RTMPConfig.skip_policy)
+        public const int RTMP_SKIP_DROP_NEWEST = 0;
+        public const int RTMP_SKIP_DROP_OLDEST = 1;
+        public const int RTMP_SKIP_KEEP_LATEST = 2;
+
+        // Video rate control modes (RTMPConfig.rate_control)
+        public const int RTMP_RATE_CONTROL_ABR = 0;
+        public const int RTMP_RATE_CONTROL_VBV = 1;
+        public const int RTMP_RATE_CONTROL_CBR = 2;
+
+        // Video encoder threading models (RTMPConfig.threading)
+        public const int RTMP_THREADING_SLICE = 0;
+        public const int RTMP_THREADING_FRAME = 1;
+
+        // Video codecs (RTMPConfig.video_codec); HEVC/AV1 need an enhanced RTMP ingest
+        public const int RTMP_VIDEO_CODEC_H264 = 0;
+        public const int RTMP_VIDEO_CODEC_HEVC = 1;
+        public const int RTMP_VIDEO_CODEC_AV1 = 2;
+
+        // Input pixel formats (RTMPConfig.pixel_format)
+        public const int RTMP_PIXEL_FORMAT_RGBA = 0;
+        public const int RTMP_PIXEL_FORMAT_BGRA = 1;
+        public const int RTMP_PIXEL_FORMAT_ARGB = 2;
+        public const int RTMP_PIXEL_FORMAT_NV12 = 3;
+        public const int RTMP_PIXEL_FORMAT_I420 = 4;
 
         // ==========================================
         // STATE ENUM
@@ -35,6 +66,8 @@ namespace Substream.Streaming
             Initialized = 1,
             Connected = 2,
             Streaming = 3,
+            Reconnecting = 4,
+            Connecting = 5,
             Error = -1
         }
 
@@ -53,6 +86,23 @@ namespace Substream.Streaming
             public int audio_sample_rate;
             public int audio_channels;
             public int audio_bitrate_kbps;
+            public int struct_size;         // Marshal.SizeOf(RTMPConfig); lets the library tell which fields follow
+            public int async_encode;
+            public int send_queue_size;
+            public int drop_policy;
+            public int flip_vertical;
+            public int pixel_format;
+            public int adaptive_bitrate;
+            public int min_bitrate_kbps;
+            public int skip_policy;
+            public int rate_control;
+            public int vbv_buffer_ms;
+            public int encoder_threads;
+            public int threading;
+            public int video_codec;
+            public int hardware_encode;
+            public int replay_buffer_seconds;
+            public int reconnect_attempts;
 
             public static RTMPConfig Default => new RTMPConfig
             {
@@ -63,10 +113,299 @@ namespace Substream.Streaming
                 keyframe_interval = 2,
                 audio_sample_rate = 44100,
                 audio_channels = 2,
-                audio_bitrate_kbps = 128
+                audio_bitrate_kbps = 128,
+                struct_size = Marshal.SizeOf(typeof(RTMPConfig)),
+                async_encode = 1,
+                send_queue_size = 0,
+                drop_policy = RTMP_DROP_NEWEST,
+                flip_vertical = 0,
+                pixel_format = RTMP_PIXEL_FORMAT_RGBA,
+                adaptive_bitrate = 0,
+                min_bitrate_kbps = 0,
+                skip_policy = RTMP_SKIP_DROP_NEWEST,
+                rate_control = RTMP_RATE_CONTROL_ABR,
+                vbv_buffer_ms = 0,
+                encoder_threads = 0,
+                threading = RTMP_THREADING_SLICE,
+                video_codec = RTMP_VIDEO_CODEC_H264,
+                hardware_encode = 0,
+                replay_buffer_seconds = 0,
+                reconnect_attempts = 0
             };
         }
 
+        // ==========================================
+        // STATISTICS STRUCTURE
+        // ==========================================
+
+        [StructLayout(LayoutKind.Sequential)]
+        public struct RTMPStats
+        {
+            public long bytes_sent;
+            public int frames_sent;
+            public int dropped_frames;
+            public int send_queue_depth;
+            public int send_queue_capacity;
+            public int send_queue_high_water;
+            public int send_queue_dropped_packets;
+            public int drop_policy;
+            public int video_bitrate_kbps;
+            public int skipped_frames;
+            public int avg_encode_us;
+            public int skip_policy;
+            public int encoder_threads;
+            public int encoder_threading;
+            public int encoder_hardware;
+            public int reconnects;
+            public int destinations_failed;
+        }
+
+        /// <summary>
+        /// Called once the native side no longer needs a frame passed to
+        /// rtmp_session_submit_video_frame. May run on the native encoder thread.
+        /// </summary>
+        [UnmanagedFunctionPointer(CallingConvention.Cdecl)]
+        public delegate void RTMPReleaseCallback(IntPtr opaque, IntPtr data);
+
+        // ==========================================
+        // SESSION API
+        // Each session is an independent stream (own encoder, connection
+        // and threads). The plain rtmp_* functions below use a default session.
+        // ==========================================
+
+        /// <summary>
+        /// Create a new native session. Free it with rtmp_session_destroy.
+        /// </summary>
+        [DllImport(LIBRARY_NAME, CallingConvention = CallingConvention.Cdecl)]
+        public static extern IntPtr rtmp_session_create();
+
+        /// <summary>
+        /// Disconnect, clean up and free a session.
+        /// </summary>
+        [DllImport(LIBRARY_NAME, CallingConvention = CallingConvention.Cdecl)]
+        public static extern void rtmp_session_destroy(IntPtr session);
+
+        [DllImport(LIBRARY_NAME, CallingConvention = CallingConvention.Cdecl)]
+        public static extern int rtmp_session_init(IntPtr session, ref RTMPConfig config);
+
+        [DllImport(LIBRARY_NAME, CallingConvention = CallingConvention.Cdecl, CharSet = CharSet.Ansi)]
+        public static extern int rtmp_session_connect(IntPtr session, [MarshalAs(UnmanagedType.LPStr)] string url);
+
+        /// <summary>
+        /// Start connecting in the background; poll rtmp_session_get_state until it leaves Connecting.
+        /// </summary>
+        [DllImport(LIBRARY_NAME, CallingConvention = CallingConvention.Cdecl, CharSet = CharSet.Ansi)]
+        public static extern int rtmp_session_connect_async(IntPtr session, [MarshalAs(UnmanagedType.LPStr)] string url);
+
+        [DllImport(LIBRARY_NAME, CallingConvention = CallingConvention.Cdecl)]
+        public static extern int rtmp_session_start_streaming(IntPtr session);
+
+        [DllImport(LIBRARY_NAME, CallingConvention = CallingConvention.Cdecl)]
+        public static extern int rtmp_session_send_video_frame(IntPtr session, IntPtr rgba_data, int data_size, long pts);
+
+        [DllImport(LIBRARY_NAME, CallingConvention = CallingConvention.Cdecl)]
+        public static extern int rtmp_session_send_video_frame(
+            IntPtr session,
+            [MarshalAs(UnmanagedType.LPArray)] byte[] rgba_data,
+            int data_size,
+            long pts
+        );
+
+        /// <summary>
+        /// Send a frame without copying it. The buffer must stay pinned and untouched
+        /// until release is called; release is called exactly once per call.
+        /// </summary>
+        [DllImport(LIBRARY_NAME, CallingConvention = CallingConvention.Cdecl)]
+        public static extern int rtmp_session_submit_video_frame(
+            IntPtr session,
+            IntPtr data, int data_size,
+            RTMPReleaseCallback release, IntPtr opaque,
+            long pts
+        );
+
+        /// <summary>
+        /// Borrow a 64-byte aligned frame buffer from the native pool (IntPtr.Zero if none is free).
+        /// Fill it in place, e.g. with AsyncGPUReadback.RequestIntoNativeArray, then submit or release it.
+        /// </summary>
+        [DllImport(LIBRARY_NAME, CallingConvention = CallingConvention.Cdecl)]
+        public static extern IntPtr rtmp_session_acquire_frame_buffer(IntPtr session, out int size);
+
+        /// <summary>
+        /// Send a pooled buffer without copying; it returns to the pool once encoded.
+        /// </summary>
+        [DllImport(LIBRARY_NAME, CallingConvention = CallingConvention.Cdecl)]
+        public static extern int rtmp_session_submit_frame_buffer(IntPtr session, IntPtr buffer, long pts);
+
+        /// <summary>
+        /// Return a pooled buffer without sending it.
+        /// </summary>
+        [DllImport(LIBRARY_NAME, CallingConvention = CallingConvention.Cdecl)]
+        public static extern int rtmp_session_release_frame_buffer(IntPtr session, IntPtr buffer);
+
+        /// <summary>
+        /// Send a frame as separate planes (Y/UV for NV12, Y/U/V for I420), each with its own stride.
+        /// </summary>
+        [DllImport(LIBRARY_NAME, CallingConvention = CallingConvention.Cdecl)]
+        public static extern int rtmp_session_send_video_planes(
+            IntPtr session,
+            IntPtr plane0, int stride0,
+            IntPtr plane1, int stride1,
+            IntPtr plane2, int stride2,
+            long pts
+        );
+
+        /// <summary>
+        /// Send a width x height region of a larger packed image with an explicit row stride.
+        /// </summary>
+        [DllImport(LIBRARY_NAME, CallingConvention = CallingConvention.Cdecl)]
+        public static extern int rtmp_session_send_video_region(
+            IntPtr session,
+            IntPtr data, int stride,
+            int crop_x, int crop_y, int crop_width, int crop_height,
+            long pts
+        );
+
+        [DllImport(LIBRARY_NAME, CallingConvention = CallingConvention.Cdecl)]
+        public static extern int rtmp_session_send_audio(
+            IntPtr session,
+            [MarshalAs(UnmanagedType.LPArray)] float[] pcm_data,
+            int num_samples,
+            long pts
+        );
+
+        /// <summary>
+        /// Change the video bitrate of a running stream without reconnecting.
+        /// </summary>
+        [DllImport(LIBRARY_NAME, CallingConvention = CallingConvention.Cdecl)]
+        public static extern int rtmp_session_set_video_bitrate(IntPtr session, int bitrate_kbps);
+
+        /// <summary>
+        /// Force the next encoded video frame to be a keyframe.
+        /// </summary>
+        [DllImport(LIBRARY_NAME, CallingConvention = CallingConvention.Cdecl)]
+        public static extern int rtmp_session_request_keyframe(IntPtr session);
+
+        /// <summary>
+        /// Set a video encoder option (after init, before connect). A null value removes it.
+        /// </summary>
+        [DllImport(LIBRARY_NAME, CallingConvention = CallingConvention.Cdecl)]
+        public static extern int rtmp_session_set_encoder_option(
+            IntPtr session,
+            [MarshalAs(UnmanagedType.LPStr)] string key,
+            [MarshalAs(UnmanagedType.LPStr)] string value);
+
+        /// <summary>
+        /// Remux the last seconds of the replay buffer into a file, starting on a keyframe. Blocks while writing.
+        /// </summary>
+        [DllImport(LIBRARY_NAME, CallingConvention = CallingConvention.Cdecl)]
+        public static extern int rtmp_session_save_replay(
+            IntPtr session,
+            [MarshalAs(UnmanagedType.LPStr)] string path,
+            int seconds);
+
+        /// <summary>
+        /// Record the encoded stream to a local .mp4/.mkv/.flv file on its own writer thread (after connect).
+        /// </summary>
+        [DllImport(LIBRARY_NAME, CallingConvention = CallingConvention.Cdecl)]
+        public static extern int rtmp_session_start_recording(
+            IntPtr session,
+            [MarshalAs(UnmanagedType.LPStr)] string path);
+
+        [DllImport(LIBRARY_NAME, CallingConvention = CallingConvention.Cdecl)]
+        public static extern int rtmp_session_stop_recording(IntPtr session);
+
+        [DllImport(LIBRARY_NAME, CallingConvention = CallingConvention.Cdecl)]
+        public static extern int rtmp_session_get_recording_state(IntPtr session);
+
+        [DllImport(LIBRARY_NAME, CallingConvention = CallingConvention.Cdecl)]
+        public static extern int rtmp_session_get_recording_stats(IntPtr session, out RTMPStats stats);
+
+        /// <summary>
+        /// Also send the encoded stream to another URL, with its own queue and thread (after init, before connect).
+        /// </summary>
+        [DllImport(LIBRARY_NAME, CallingConvention = CallingConvention.Cdecl)]
+        public static extern int rtmp_session_add_destination(
+            IntPtr session,
+            [MarshalAs(UnmanagedType.LPStr)] string url);
+
+        [DllImport(LIBRARY_NAME, CallingConvention = CallingConvention.Cdecl)]
+        public static extern int rtmp_session_get_destination_state(IntPtr session, int index);
+
+        [DllImport(LIBRARY_NAME, CallingConvention = CallingConvention.Cdecl)]
+        public static extern int rtmp_session_get_destination_stats(IntPtr session, int index, out RTMPStats stats);
+
+        /// <summary>
+        /// Add a lower resolution simulcast output with its own URL (after init, before connect).
+        /// </summary>
+        [DllImport(LIBRARY_NAME, CallingConvention = CallingConvention.Cdecl)]
+        public static extern int rtmp_session_add_rendition(
+            IntPtr session,
+            [MarshalAs(UnmanagedType.LPStr)] string url,
+            int width, int height, int bitrate_kbps);
+
+        [DllImport(LIBRARY_NAME, CallingConvention = CallingConvention.Cdecl)]
+        public static extern int rtmp_session_get_rendition_stats(IntPtr session, int index, out RTMPStats stats);
+
+        [DllImport(LIBRARY_NAME, CallingConvention = CallingConvention.Cdecl)]
+        public static extern int rtmp_session_stop_streaming(IntPtr session);
+
+        [DllImport(LIBRARY_NAME, CallingConvention = CallingConvention.Cdecl)]
+        public static extern int rtmp_session_disconnect(IntPtr session);
+
+        [DllImport(LIBRARY_NAME, CallingConvention = CallingConvention.Cdecl)]
+        public static extern void rtmp_session_cleanup(IntPtr session);
+
+        [DllImport(LIBRARY_NAME, CallingConvention = CallingConvention.Cdecl)]
+        public static extern int rtmp_session_get_state(IntPtr session);
+
+        [DllImport(LIBRARY_NAME, CallingConvention = CallingConvention.Cdecl)]
+        private static extern IntPtr rtmp_session_get_error(IntPtr session);
+
+        [DllImport(LIBRARY_NAME, CallingConvention = CallingConvention.Cdecl)]
+        public static extern int rtmp_session_get_stats(IntPtr session, out RTMPStats stats);
+
+        /// <summary>
+        /// Run video encoder selection (hardware first if enabled, then software) without connecting.
+        /// </summary>
+        [DllImport(LIBRARY_NAME, CallingConvention = CallingConvention.Cdecl)]
+        public static extern int rtmp_session_probe_video_encoder(IntPtr session);
+
+        [DllImport(LIBRARY_NAME, CallingConvention = CallingConvention.Cdecl)]
+        private static extern IntPtr rtmp_session_get_video_encoder(IntPtr session);
+
+        [DllImport(LIBRARY_NAME, CallingConvention = CallingConvention.Cdecl)]
+        private static extern IntPtr rtmp_session_get_encoder_probe(IntPtr session);
+
+        /// <summary>
+        /// Get a session's last error as string.
+        /// </summary>
+        public static string GetError(IntPtr session)
+        {
+            IntPtr ptr = rtmp_session_get_error(session);
+            if (ptr == IntPtr.Zero) return string.Empty;
+            return Marshal.PtrToStringAnsi(ptr) ?? string.Empty;
+        }
+
+        /// <summary>
+        /// Name of the video encoder chosen by the session's last connect or probe.
+        /// </summary>
+        public static string GetVideoEncoder(IntPtr session)
+        {
+            IntPtr ptr = rtmp_session_get_video_encoder(session);
+            if (ptr == IntPtr.Zero) return string.Empty;
+            return Marshal.PtrToStringAnsi(ptr) ?? string.Empty;
+        }
+
+        /// <summary>
+        /// Every encoder the session's last connect or probe tried, in order, with the result of each.
+        /// </summary>
+        public static string GetEncoderProbe(IntPtr session)
+        {
+            IntPtr ptr = rtmp_session_get_encoder_probe(session);
+            if (ptr == IntPtr.Zero) return string.Empty;
+            return Marshal.PtrToStringAnsi(ptr) ?? string.Empty;
+        }
+
         // ==========================================
         // NATIVE FUNCTION IMPORTS
         // ==========================================
@@ -77,6 +416,13 @@ namespace Substream.Streaming
         [DllImport(LIBRARY_NAME, CallingConvention = CallingConvention.Cdecl)]
         public static extern int rtmp_init(ref RTMPConfig config);
 
+        /// <summary>
+        /// Initialize with the full configuration structure (config.struct_size must be set).
+        /// rtmp_init only reads the fields up to audio_bitrate_kbps.
+        /// </summary>
+        [DllImport(LIBRARY_NAME, CallingConvention = CallingConvention.Cdecl)]
+        public static extern int rtmp_init_ex(ref RTMPConfig config);
+
         /// <summary>
         /// Initialize with individual parameters (simpler to call from C#).
         /// </summary>
@@ -99,6 +445,14 @@ namespace Substream.Streaming
         [DllImport(LIBRARY_NAME, CallingConvention = CallingConvention.Cdecl, CharSet = CharSet.Ansi)]
         public static extern int rtmp_connect([MarshalAs(UnmanagedType.LPStr)] string url);
 
+        /// <summary>
+        /// Start connecting in the background and return immediately.
+        /// State is Connecting until it ends in Connected or Error.
+        /// </summary>
+        /// <param name="url">Full RTMP URL including stream key</param>
+        [DllImport(LIBRARY_NAME, CallingConvention = CallingConvention.Cdecl, CharSet = CharSet.Ansi)]
+        public static extern int rtmp_connect_async([MarshalAs(UnmanagedType.LPStr)] string url);
+
         /// <summary>
         /// Start streaming (call after connect).
         /// </summary>
@@ -108,8 +462,8 @@ namespace Substream.Streaming
         /// <summary>
         /// Send a video frame.
         /// </summary>
-        /// <param name="rgba_data">Pointer to RGBA pixel data</param>
-        /// <param name="data_size">Size in bytes (width * height * 4)</param>
+        /// <param name="rgba_data">Pointer to pixel data in the configured pixel_format</param>
+        /// <param name="data_size">Size in bytes (width * height * 4 for RGBA/BGRA/ARGB)</param>
         /// <param name="pts">Presentation timestamp in milliseconds</param>
         [DllImport(LIBRARY_NAME, CallingConvention = CallingConvention.Cdecl)]
         public static extern int rtmp_send_video_frame(IntPtr rgba_data, int data_size, long pts);
@@ -124,6 +478,28 @@ namespace Substream.Streaming
             long pts
         );
 
+        /// <summary>
+        /// Send a video frame as separate planes with their own row strides.
+        /// </summary>
+        [DllImport(LIBRARY_NAME, CallingConvention = CallingConvention.Cdecl)]
+        public static extern int rtmp_send_video_planes(
+            IntPtr plane0, int stride0,
+            IntPtr plane1, int stride1,
+            IntPtr plane2, int stride2,
+            long pts
+        );
+
+        /// <summary>
+        /// Send a region of a larger packed image (padded readback, letterbox) without repacking.
+        /// </summary>
+        /// <param name="stride">Bytes between source rows</param>
+        [DllImport(LIBRARY_NAME, CallingConvention = CallingConvention.Cdecl)]
+        public static extern int rtmp_send_video_region(
+            IntPtr data, int stride,
+            int crop_x, int crop_y, int crop_width, int crop_height,
+            long pts
+        );
+
         /// <summary>
         /// Send audio samples.
         /// </summary>
@@ -143,6 +519,26 @@ namespace Substream.Streaming
             long pts
         );
 
+        /// <summary>
+        /// Change the video bitrate without reconnecting.
+        /// </summary>
+        [DllImport(LIBRARY_NAME, CallingConvention = CallingConvention.Cdecl)]
+        public static extern int rtmp_set_video_bitrate(int bitrate_kbps);
+
+        /// <summary>
+        /// Force the next encoded video frame to be a keyframe.
+        /// </summary>
+        [DllImport(LIBRARY_NAME, CallingConvention = CallingConvention.Cdecl)]
+        public static extern int rtmp_request_keyframe();
+
+        /// <summary>
+        /// Set a video encoder option (after init, before connect). A null value removes it.
+        /// </summary>
+        [DllImport(LIBRARY_NAME, CallingConvention = CallingConvention.Cdecl)]
+        public static extern int rtmp_set_encoder_option(
+            [MarshalAs(UnmanagedType.LPStr)] string key,
+            [MarshalAs(UnmanagedType.LPStr)] string value);
+
         /// <summary>
         /// Stop streaming but keep connection.
         /// </summary>
@@ -173,6 +569,86 @@ namespace Substream.Streaming
         [DllImport(LIBRARY_NAME, CallingConvention = CallingConvention.Cdecl)]
         private static extern IntPtr rtmp_get_error();
 
+        /// <summary>
+        /// Run video encoder selection without connecting.
+        /// </summary>
+        [DllImport(LIBRARY_NAME, CallingConvention = CallingConvention.Cdecl)]
+        public static extern int rtmp_probe_video_encoder();
+
+        /// <summary>
+        /// Get the video encoder chosen by the last connect or probe.
+        /// </summary>
+        [DllImport(LIBRARY_NAME, CallingConvention = CallingConvention.Cdecl)]
+        private static extern IntPtr rtmp_get_video_encoder();
+
+        /// <summary>
+        /// Get the encoders the last connect or probe tried.
+        /// </summary>
+        [DllImport(LIBRARY_NAME, CallingConvention = CallingConvention.Cdecl)]
+        private static extern IntPtr rtmp_get_encoder_probe();
+
+        /// <summary>
+        /// Remux the last seconds of the replay buffer into a file.
+        /// </summary>
+        [DllImport(LIBRARY_NAME, CallingConvention = CallingConvention.Cdecl)]
+        public static extern int rtmp_save_replay([MarshalAs(UnmanagedType.LPStr)] string path, int seconds);
+
+        /// <summary>
+        /// Record the encoded stream to a local .mp4/.mkv/.flv file (after connect).
+        /// </summary>
+        [DllImport(LIBRARY_NAME, CallingConvention = CallingConvention.Cdecl)]
+        public static extern int rtmp_start_recording([MarshalAs(UnmanagedType.LPStr)] string path);
+
+        /// <summary>
+        /// Stop recording and finish the file.
+        /// </summary>
+        [DllImport(LIBRARY_NAME, CallingConvention = CallingConvention.Cdecl)]
+        public static extern int rtmp_stop_recording();
+
+        /// <summary>
+        /// Get the recording state (Idle, Connected while recording, Error once a write failed).
+        /// </summary>
+        [DllImport(LIBRARY_NAME, CallingConvention = CallingConvention.Cdecl)]
+        public static extern int rtmp_get_recording_state();
+
+        /// <summary>
+        /// Get recording statistics.
+        /// </summary>
+        [DllImport(LIBRARY_NAME, CallingConvention = CallingConvention.Cdecl)]
+        public static extern int rtmp_get_recording_stats(out RTMPStats stats);
+
+        /// <summary>
+        /// Also send the encoded stream to another URL, with its own queue and thread (after init, before connect).
+        /// </summary>
+        [DllImport(LIBRARY_NAME, CallingConvention = CallingConvention.Cdecl)]
+        public static extern int rtmp_add_destination([MarshalAs(UnmanagedType.LPStr)] string url);
+
+        /// <summary>
+        /// Get a destination's state (RTMPState.Error once it failed).
+        /// </summary>
+        [DllImport(LIBRARY_NAME, CallingConvention = CallingConvention.Cdecl)]
+        public static extern int rtmp_get_destination_state(int index);
+
+        /// <summary>
+        /// Get a destination's network statistics.
+        /// </summary>
+        [DllImport(LIBRARY_NAME, CallingConvention = CallingConvention.Cdecl)]
+        public static extern int rtmp_get_destination_stats(int index, out RTMPStats stats);
+
+        /// <summary>
+        /// Add a lower resolution simulcast output with its own URL (after init, before connect).
+        /// </summary>
+        [DllImport(LIBRARY_NAME, CallingConvention = CallingConvention.Cdecl)]
+        public static extern int rtmp_add_rendition(
+            [MarshalAs(UnmanagedType.LPStr)] string url,
+            int width, int height, int bitrate_kbps);
+
+        /// <summary>
+        /// Get statistics for a rendition, in the order they were added.
+        /// </summary>
+        [DllImport(LIBRARY_NAME, CallingConvention = CallingConvention.Cdecl)]
+        public static extern int rtmp_get_rendition_stats(int index, out RTMPStats stats);
+
         /// <summary>
         /// Check if this native library is a stub build (optional).
         /// </summary>
@@ -195,6 +671,26 @@ namespace Substream.Streaming
             return Marshal.PtrToStringAnsi(ptr) ?? string.Empty;
         }
 
+        /// <summary>
+        /// Get the video encoder chosen by the last connect or probe as string.
+        /// </summary>
+        public static string GetVideoEncoder()
+        {
+            IntPtr ptr = rtmp_get_video_encoder();
+            if (ptr == IntPtr.Zero) return string.Empty;
+            return Marshal.PtrToStringAnsi(ptr) ?? string.Empty;
+        }
+
+        /// <summary>
+        /// Get the encoders the last connect or probe tried as string.
+        /// </summary>
+        public static string GetEncoderProbe()
+        {
+            IntPtr ptr = rtmp_get_encoder_probe();
+            if (ptr == IntPtr.Zero) return string.Empty;
+            return Marshal.PtrToStringAnsi(ptr) ?? string.Empty;
+        }
+
         /// <summary>
         /// Try to read build info string from native library.
         /// </summary>
@@ -261,6 +757,12 @@ namespace Substream.Streaming
         [DllImport(LIBRARY_NAME, CallingConvention = CallingConvention.Cdecl)]
         public static extern int rtmp_get_dropped_frames();
 
+        /// <summary>
+        /// Get a statistics snapshot including send queue depth and drops.
+        /// </summary>
+        [DllImport(LIBRARY_NAME, CallingConvention = CallingConvention.Cdecl)]
+        public static extern int rtmp_get_stats(out RTMPStats stats);
+
         // ==========================================
         // HELPER METHODS
         // ==========================================
@@ -354,6 +856,18 @@ namespace Substream.Streaming
             }
         }
 
+        /// <summary>
+        /// Bytes of one tightly packed frame in the given pixel format.
+        /// </summary>
+        public static int GetFrameSize(int pixelFormat, int width, int height)
+        {
+            if (pixelFormat == RTMP_PIXEL_FORMAT_NV12 || pixelFormat == RTMP_PIXEL_FORMAT_I420)
+            {
+                return width * height + 2 * ((width + 1) / 2) * ((height + 1) / 2);
+            }
+            return width * height * 4;
+        }
+
         /// <summary>
         /// Get state as enum.
         /// </summary>
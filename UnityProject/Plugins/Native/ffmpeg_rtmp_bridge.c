@@ -7,11 +7,13 @@
  * - libavcodec (encoding)
  * - libavformat (muxing/RTMP)
  * - libavutil (utilities)
- * - libswscale (color conversion)
+ * - libswscale (color conversion verification, RTMP_VERIFY_COLORCONV only)
  * - libswresample (audio resampling)
  */
 
 #include "ffmpeg_rtmp_bridge.h"
+#include "ffmpeg_rtmp_colorconv.h"
+#include <stddef.h>
 #include <stdlib.h>
 #include <string.h>
 #include <stdio.h>
@@ -22,6 +24,8 @@
 #include <libavutil/opt.h>
 #include <libavutil/imgutils.h>
 #include <libavutil/time.h>
+#include <libavutil/cpu.h>
+#include <libavutil/hwcontext.h>
 #include <libswscale/swscale.h>
 #include <libswresample/swresample.h>
 
@@ -33,6 +37,27 @@
 #define MUTEX_LOCK(m) EnterCriticalSection(&m)
 #define MUTEX_UNLOCK(m) LeaveCriticalSection(&m)
 #define MUTEX_DESTROY(m) DeleteCriticalSection(&m)
+#define COND_TYPE CONDITION_VARIABLE
+#define COND_INIT(c) InitializeConditionVariable(&c)
+#define COND_WAIT(c, m) SleepConditionVariableCS(&c, &m, INFINITE)
+#define COND_SIGNAL(c) WakeConditionVariable(&c)
+#define COND_BROADCAST(c) WakeAllConditionVariable(&c)
+#define COND_DESTROY(c) ((void)0)
+#define THREAD_TYPE HANDLE
+#define THREAD_PROC(name) DWORD WINAPI name(LPVOID arg)
+#define THREAD_RETURN return 0
+#define THREAD_CREATE(t, fn, arg) (((t) = CreateThread(NULL, 0, fn, arg, 0, NULL)) != NULL ? 0 : -1)
+#define THREAD_JOIN(t) (WaitForSingleObject(t, INFINITE), CloseHandle(t))
+#define ATOMIC_INT volatile LONG
+#define ATOMIC_INT64 volatile LONG64
+#define ATOMIC_LOAD(p) InterlockedCompareExchange((p), 0, 0)
+#define ATOMIC_STORE(p, v) InterlockedExchange((p), (v))
+#define ATOMIC_EXCHANGE(p, v) InterlockedExchange((p), (v))
+#define ATOMIC_ADD(p, v) InterlockedExchangeAdd((p), (v))
+#define ATOMIC_LOAD64(p) InterlockedCompareExchange64((p), 0, 0)
+#define ATOMIC_STORE64(p, v) InterlockedExchange64((p), (v))
+#define ATOMIC_ADD64(p, v) InterlockedExchangeAdd64((p), (v))
+#define ATOMIC_CAS(p, expected, desired) (InterlockedCompareExchange((p), (desired), (expected)) == (expected))
 #else
 #include <pthread.h>
 #define MUTEX_TYPE pthread_mutex_t
@@ -40,10 +65,272 @@
 #define MUTEX_LOCK(m) pthread_mutex_lock(&m)
 #define MUTEX_UNLOCK(m) pthread_mutex_unlock(&m)
 #define MUTEX_DESTROY(m) pthread_mutex_destroy(&m)
+#define COND_TYPE pthread_cond_t
+#define COND_INIT(c) pthread_cond_init(&c, NULL)
+#define COND_WAIT(c, m) pthread_cond_wait(&c, &m)
+#define COND_SIGNAL(c) pthread_cond_signal(&c)
+#define COND_BROADCAST(c) pthread_cond_broadcast(&c)
+#define COND_DESTROY(c) pthread_cond_destroy(&c)
+#define THREAD_TYPE pthread_t
+#define THREAD_PROC(name) void* name(void* arg)
+#define THREAD_RETURN return NULL
+#define THREAD_CREATE(t, fn, arg) pthread_create(&(t), NULL, fn, arg)
+#define THREAD_JOIN(t) pthread_join(t, NULL)
+#define ATOMIC_INT int
+#define ATOMIC_INT64 int64_t
+#define ATOMIC_LOAD(p) __atomic_load_n((p), __ATOMIC_SEQ_CST)
+#define ATOMIC_STORE(p, v) __atomic_store_n((p), (v), __ATOMIC_SEQ_CST)
+#define ATOMIC_EXCHANGE(p, v) __atomic_exchange_n((p), (v), __ATOMIC_SEQ_CST)
+#define ATOMIC_ADD(p, v) __atomic_fetch_add((p), (v), __ATOMIC_SEQ_CST)
+#define ATOMIC_LOAD64(p) __atomic_load_n((p), __ATOMIC_SEQ_CST)
+#define ATOMIC_STORE64(p, v) __atomic_store_n((p), (v), __ATOMIC_SEQ_CST)
+#define ATOMIC_ADD64(p, v) __atomic_fetch_add((p), (v), __ATOMIC_SEQ_CST)
+#define ATOMIC_CAS(p, expected, desired) __extension__ ({ \
+    int expected_ = (expected); \
+    __atomic_compare_exchange_n((p), &expected_, (desired), 0, __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST); \
+})
 #endif
 
-// Global state
-static struct {
+// Async encode ring depths. The slot being encoded stays owned by the encoder
+// thread, the rest buffer data submitted in the meantime.
+#define RTMP_VIDEO_RING_SLOTS 3
+#define RTMP_AUDIO_RING_SLOTS 16
+#define RTMP_AUDIO_SLOT_SAMPLES 4096  // per channel; larger submits span several slots
+
+// Frame buffers lent to the caller: enough to fill the video ring plus two
+// GPU readbacks in flight
+#define RTMP_FRAME_POOL_BUFFERS (RTMP_VIDEO_RING_SLOTS + 2)
+#define RTMP_FRAME_POOL_ALIGN 64
+
+typedef struct {
+    uint8_t* data;          // preallocated, slot_size bytes
+    int size;               // bytes used
+    int64_t pts;
+    AVBufferRef* external;  // caller-owned frame used instead of data (zero-copy submit)
+    AVFrame* source;        // renditions: reference to the parent's converted frame
+} RingSlot;
+
+// Lock-free single-producer/single-consumer ring of preallocated slots.
+// The producer only writes write_index and the consumer only writes
+// read_index; one slot is always left empty to tell full from empty.
+typedef struct {
+    RingSlot* slots;
+    int capacity;
+    int slot_size;
+    ATOMIC_INT read_index;
+    ATOMIC_INT write_index;
+} SPSCRing;
+
+// Pool buffer states
+#define FRAME_BUFFER_FREE 0
+#define FRAME_BUFFER_ACQUIRED 1  // lent to the caller
+#define FRAME_BUFFER_QUEUED 2    // submitted, owned by the encoder until released
+
+typedef struct {
+    uint8_t* raw;   // allocation, data is raw rounded up to RTMP_FRAME_POOL_ALIGN
+    uint8_t* data;
+    ATOMIC_INT state;
+} FrameBuffer;
+
+// Caller release callback behind an AVBufferRef wrapping a zero-copy frame
+typedef struct {
+    RTMPReleaseCallback release;
+    void* opaque;
+} ExternalFrame;
+
+// Plane pointers and row strides of one submitted frame, in config.pixel_format
+typedef struct {
+    const uint8_t* data[3];
+    int stride[3];
+} VideoInput;
+
+// Default send queue capacity, about two seconds of 30fps video plus AAC audio
+#define RTMP_DEFAULT_SEND_QUEUE_SIZE 160
+
+// Default VBV buffer for RTMP_RATE_CONTROL_VBV/CBR, in milliseconds of bitrate
+#define RTMP_DEFAULT_VBV_BUFFER_MS 1000
+
+// The FLV muxer writes HEVC and AV1 with enhanced RTMP FourCC headers
+// ('hvc1', 'av01') from FFmpeg 6.1 on; older muxers only know H.264.
+#if LIBAVFORMAT_VERSION_INT >= AV_VERSION_INT(60, 16, 100)
+#define RTMP_HAVE_ENHANCED_FLV 1
+#else
+#define RTMP_HAVE_ENHANCED_FLV 0
+#endif
+
+// Hardware encoder candidate. Most take software frames; the ones with a
+// device (VAAPI) need frames uploaded to it first.
+typedef struct {
+    const char* name;
+    enum AVHWDeviceType device;     // AV_HWDEVICE_TYPE_NONE = software frames
+    enum AVPixelFormat hw_format;   // frame format on the device
+} HardwareEncoder;
+
+// Video codecs (RTMPConfig.video_codec) and the encoders tried for each, in
+// order: hardware first when config.hardware_encode is set, then software.
+// Encoders not built into this FFmpeg are skipped and one that fails to
+// open (no GPU, no driver) falls through to the next. If no listed encoder
+// opens, whatever encoder libavcodec registers for the codec is tried.
+typedef struct {
+    enum AVCodecID id;
+    const char* name;
+    HardwareEncoder hardware[5];
+    const char* encoders[3];
+} VideoCodecInfo;
+
+static const VideoCodecInfo VIDEO_CODECS[] = {
+    [RTMP_VIDEO_CODEC_H264] = {
+        AV_CODEC_ID_H264, "H.264",
+        {
+            { "h264_nvenc", AV_HWDEVICE_TYPE_NONE, AV_PIX_FMT_NONE },
+            { "h264_vaapi", AV_HWDEVICE_TYPE_VAAPI, AV_PIX_FMT_VAAPI },
+            { "h264_mediacodec", AV_HWDEVICE_TYPE_NONE, AV_PIX_FMT_NONE },
+            { "h264_videotoolbox", AV_HWDEVICE_TYPE_NONE, AV_PIX_FMT_NONE },
+        },
+        { "libx264", NULL }
+    },
+    [RTMP_VIDEO_CODEC_HEVC] = {
+        AV_CODEC_ID_HEVC, "HEVC",
+        {
+            { "hevc_nvenc", AV_HWDEVICE_TYPE_NONE, AV_PIX_FMT_NONE },
+            { "hevc_vaapi", AV_HWDEVICE_TYPE_VAAPI, AV_PIX_FMT_VAAPI },
+            { "hevc_mediacodec", AV_HWDEVICE_TYPE_NONE, AV_PIX_FMT_NONE },
+            { "hevc_videotoolbox", AV_HWDEVICE_TYPE_NONE, AV_PIX_FMT_NONE },
+        },
+        { "libx265", NULL }
+    },
+    [RTMP_VIDEO_CODEC_AV1] = {
+        AV_CODEC_ID_AV1, "AV1",
+        {
+            { "av1_nvenc", AV_HWDEVICE_TYPE_NONE, AV_PIX_FMT_NONE },
+            { "av1_vaapi", AV_HWDEVICE_TYPE_VAAPI, AV_PIX_FMT_VAAPI },
+            { "av1_mediacodec", AV_HWDEVICE_TYPE_NONE, AV_PIX_FMT_NONE },
+        },
+        { "libsvtav1", "libaom-av1", NULL }
+    },
+};
+
+// Upper bound for encoder_threads = 0. Every slice thread adds a slice,
+// which costs compression, so more cores than this rarely pay off.
+#define RTMP_MAX_AUTO_THREADS 8
+
+// Bounded queue of encoded packets between the encoders and the sender thread.
+// Packets are moved in and out of preallocated AVPackets, so queuing never
+// allocates. When full, video is dropped according to drop_policy and resumes
+// at the next keyframe so the receiver never sees a broken reference chain.
+// Counters are atomic so stats can be read without taking the queue lock.
+typedef struct {
+    AVPacket** packets;
+    int capacity;
+    int head;
+    ATOMIC_INT count;
+    ATOMIC_INT high_water;
+    int drop_policy;
+    int video_stream_index;
+    int waiting_for_keyframe;
+    ATOMIC_INT dropped_packets;
+    ATOMIC_INT dropped_video;
+    int finished;
+    MUTEX_TYPE mutex;
+    COND_TYPE cond;
+} PacketQueue;
+
+// Adaptive bitrate (config.adaptive_bitrate): the sender thread measures each
+// window and backs the video bitrate off multiplicatively when the network
+// falls behind, then ramps it back up in small steps once it keeps up.
+#define RTMP_ABR_WINDOW_US 1000000
+#define RTMP_ABR_DECREASE_PCT 70     // new rate as % of current on congestion
+#define RTMP_ABR_INCREASE_PCT 10     // step up as % of the ceiling
+#define RTMP_ABR_CLEAR_WINDOWS 3     // uncongested windows before stepping up
+#define RTMP_ABR_BUSY_HIGH_PCT 70    // share of the window spent blocked in writes
+#define RTMP_ABR_BUSY_LOW_PCT 30
+
+// Auto-reconnect backoff (config.reconnect_attempts): doubles per attempt
+#define RTMP_RECONNECT_MIN_DELAY_MS 500
+#define RTMP_RECONNECT_MAX_DELAY_MS 8000
+#define RTMP_RECONNECT_POLL_MS 50     // how often a backoff checks for disconnect
+
+// Owned by the sender thread, except max_kbps
+typedef struct {
+    int enabled;
+    int min_kbps;
+    ATOMIC_INT max_kbps;    // ceiling, follows rtmp_set_video_bitrate
+    int current_kbps;
+    int64_t window_start;
+    int64_t write_us;       // time spent in av_interleaved_write_frame this window
+    int max_depth;          // deepest send queue seen this window
+    int last_dropped;       // queue video drops at the start of the window
+    int clear_windows;
+} AbrController;
+
+// Network half of connect: DNS, TCP, TLS and the RTMP handshake. Runs on
+// its own thread while the encoders open.
+typedef struct {
+    const char* url;
+    const AVIOInterruptCB* interrupt;
+    AVIOContext* pb;
+    int ret;
+} NetworkOpen;
+
+// Extra output (rtmp_add_destination, rtmp_start_recording): another muxer fed references to the
+// same encoded packets as the main stream. Each has its own queue and writer
+// thread, so an output that stalls or fails only ever drops its own packets.
+#define RTMP_MAX_DESTINATIONS 4
+#define RTMP_OUTPUT_CLOSE_TIMEOUT_US 2000000    // how long close waits for a stalled output to flush
+
+typedef struct {
+    char* url;
+    AVFormatContext* format_ctx;
+    AVRational time_base[2];    // main stream time base, per stream index
+    PacketQueue queue;
+    AVPacket* packet;           // owned by the writer thread
+    THREAD_TYPE thread;
+    int running;
+    ATOMIC_INT state;           // RTMP_STATE_*, ERROR once a write fails
+    ATOMIC_INT64 bytes_sent;
+    ATOMIC_INT abort;           // cancels a blocked open or write
+    ATOMIC_INT64 close_deadline;    // set by close_output, 0 while open
+    AVIOInterruptCB interrupt;  // output_interrupted, for the open and every write
+    
+    // Destinations: handshake on net_thread, alongside the main connection
+    NetworkOpen net;
+    THREAD_TYPE net_thread;
+    int net_started;
+} Output;
+
+// Replay buffer (config.replay_buffer_seconds): references to the most recent
+// encoded packets, so rtmp_save_replay can remux them without re-encoding.
+// Whole GOPs are evicted once the next one still covers the window, and
+// keyframes are indexed by sequence number so a save finds its start
+// without scanning. Kept after disconnect until the next connect.
+typedef struct {
+    AVPacket** packets;
+    int capacity;
+    int head;
+    int count;
+    int64_t first_seq;          // sequence number of packets[head]
+    int64_t* keyframes;         // sequence numbers of buffered video keyframes
+    int key_head;
+    int key_count;
+    int64_t window_us;
+    int video_stream_index;
+    AVRational time_base[2];
+    AVCodecParameters* codecpar[2];
+    int nb_streams;
+} ReplayBuffer;
+
+// Simulcast rendition (rtmp_add_rendition): a child session with its own
+// encoder, output and threads. The parent queues a reference to each
+// converted frame; the child scales it down on its own encoder thread.
+#define RTMP_MAX_RENDITIONS 4
+
+typedef struct {
+    RTMPSession* session;
+    char* url;
+} Rendition;
+
+// Per-session state. Sessions share nothing, so several can stream in parallel.
+struct RTMPSession {
     RTMPState state;
     RTMPConfig config;
     char error_msg[512];
@@ -56,702 +343,4004 @@ static struct {
     AVStream* audio_stream;
     
     // Scaling/conversion
+#ifdef RTMP_VERIFY_COLORCONV
     struct SwsContext* sws_ctx;
+    AVFrame* verify_frame;
+    int verify_max_diff;
+#endif
     struct SwrContext* swr_ctx;
     
-    // Frames and packets
+    // Frames and packets. video_frame holds the converted input; encoders
+    // that only take NV12 get an interleaved copy in upload_frame, and VAAPI
+    // encoders a copy on the device in hw_frame.
     AVFrame* video_frame;
+    AVFrame* upload_frame;
+    AVFrame* hw_frame;
+    AVBufferRef* hw_device_ctx;
     AVFrame* audio_frame;
     AVPacket* packet;
+    AVPacket* sender_packet;
     
-    // Statistics
-    int64_t bytes_sent;
-    int frames_sent;
-    int dropped_frames;
+    // Statistics (atomic, read without locking)
+    ATOMIC_INT64 bytes_sent;
+    ATOMIC_INT frames_sent;
+    ATOMIC_INT skipped_frames;      // video frames shed because the encoder is behind
+    ATOMIC_INT avg_encode_us;       // moving average of encode_and_send_video
+    int64_t next_sync_encode;       // sync mode: frames before this time are skipped
     int64_t start_time;
     
+    // Bitrate requested by rtmp_set_video_bitrate, applied by the encoding thread (0 = none)
+    ATOMIC_INT pending_bitrate_kbps;
+    
+    // Set by rtmp_request_keyframe, consumed by the next encoded video frame
+    ATOMIC_INT keyframe_requested;
+    
+    // Encoder options from rtmp_set_encoder_option, applied when the encoder is opened
+    AVDictionary* encoder_options;
+    
+    // Fan-out destinations, opened at connect after the main stream
+    Output destinations[RTMP_MAX_DESTINATIONS];
+    int destination_count;
+    AVPacket* fanout_packet;    // reference handed to each destination queue
+    
+    ReplayBuffer replay;
+    MUTEX_TYPE replay_mutex;
+    
+    // Local recording, started and stopped while streaming. recording_mutex
+    // keeps send_packet from queuing into it while it opens or closes.
+    Output recording;
+    MUTEX_TYPE recording_mutex;
+    
+    // Simulcast renditions
+    Rendition renditions[RTMP_MAX_RENDITIONS];
+    int rendition_count;
+    
+    // In a rendition: scales the parent's frames, encoder thread only
+    int is_rendition;
+    struct SwsContext* source_sws;
+    
+    // Threading the video encoder was opened with
+    int encoder_threads;
+    int encoder_threading;
+    
+    // Video encoder chosen by the last connect or probe, and every candidate
+    // tried on the way ("h264_vaapi: No VAAPI device ...; libx264: ok")
+    char video_encoder[64];
+    char encoder_probe[512];
+    int encoder_hardware;
+    int encoder_runtime_bitrate;    // the open encoder follows bit_rate changes mid-stream
+    
+    // Async encode (config.async_encode): video and audio are copied into
+    // lock-free rings and encoded on encoder_thread. The wake mutex is only
+    // touched when the encoder is idle, never while it encodes.
+    SPSCRing video_ring;
+    SPSCRing audio_ring;
+    
+    // Send calls may come from other threads than stop/disconnect (Unity's
+    // audio thread), so producers count themselves in ring_users while they
+    // write and stop_encoder_thread waits for them before freeing the rings
+    ATOMIC_INT rings_open;
+    ATOMIC_INT ring_users;
+    
+    // Aligned frame buffers the caller can fill in place (rtmp_acquire_frame_buffer),
+    // allocated by the first acquire: a few full frames most callers never use
+    FrameBuffer frame_pool[RTMP_FRAME_POOL_BUFFERS];
+    ATOMIC_INT frame_pool_size;
+    ATOMIC_INT encoder_stop;
+    ATOMIC_INT encoder_sleeping;
+    ATOMIC_INT async_error;
+    int encoder_running;
+    THREAD_TYPE encoder_thread;
+    MUTEX_TYPE wake_mutex;
+    COND_TYPE wake_cond;
+    
+    // Network sender: encoders push into send_queue, sender_thread writes to the socket
+    PacketQueue send_queue;
+    
+    // Auto-reconnect (config.reconnect_attempts). format_ctx keeps the stream
+    // layout the encoders use; after a reconnect the sender writes to
+    // link_ctx, a fresh muxer with the same streams. Sender thread only.
+    AVFormatContext* link_ctx;
+    ATOMIC_INT reconnecting;
+    ATOMIC_INT reconnects;
+    ATOMIC_INT sender_stop;
+    AbrController abr;
+    THREAD_TYPE sender_thread;
+    int sender_running;
+    
+    // Errors raised on the sender thread, which never takes s->mutex (stop
+    // holds it while joining). take_async_error moves them into error_msg.
+    char sender_error[256];
+    MUTEX_TYPE sender_error_mutex;
+    
+    // Connect, on connect_thread for rtmp_connect_async. connect_cancel
+    // aborts the network steps when disconnect is called meanwhile.
+    char* connect_url;
+    int connect_async;
+    THREAD_TYPE connect_thread;
+    int connect_thread_started;
+    ATOMIC_INT connect_cancel;
+    
     // Thread safety
     MUTEX_TYPE mutex;
     int mutex_initialized;
     
-} g_rtmp = {0};
+};
+
+// Session behind the legacy rtmp_* functions
+static RTMPSession g_default_session = {0};
 
 // Helper macros
-#define SET_ERROR(fmt, ...) snprintf(g_rtmp.error_msg, sizeof(g_rtmp.error_msg), fmt, ##__VA_ARGS__)
-#define CHECK_STATE(expected) if (g_rtmp.state != expected) { SET_ERROR("Invalid state: expected %d, got %d", expected, g_rtmp.state); return RTMP_ERROR_NOT_CONNECTED; }
+#define SET_ERROR(s, fmt, ...) snprintf((s)->error_msg, sizeof((s)->error_msg), fmt, ##__VA_ARGS__)
+#define SET_SENDER_ERROR(s, fmt, ...) do { \
+    MUTEX_LOCK((s)->sender_error_mutex); \
+    snprintf((s)->sender_error, sizeof((s)->sender_error), fmt, ##__VA_ARGS__); \
+    MUTEX_UNLOCK((s)->sender_error_mutex); \
+} while (0)
+#define CHECK_STATE(s, expected) if ((s)->state != expected) { SET_ERROR(s, "Invalid state: expected %d, got %d", expected, (s)->state); return RTMP_ERROR_NOT_CONNECTED; }
 
 // Forward declarations
-static int init_video_encoder(void);
-static int init_audio_encoder(void);
-static int encode_and_send_video(const uint8_t* rgba_data, int64_t pts);
-static int encode_and_send_audio(const float* pcm_data, int num_samples, int64_t pts);
+static int init_video_encoder(RTMPSession* s);
+static void free_video_encoder(RTMPSession* s);
+static int connect_renditions(RTMPSession* s);
+static void cancel_connect(RTMPSession* s);
+static void join_connect_thread(RTMPSession* s);
+static int disconnect_session(RTMPSession* s);
+static void start_destination_opens(RTMPSession* s);
+static void join_destination_opens(RTMPSession* s);
+static void open_destinations(RTMPSession* s);
+static void close_destinations(RTMPSession* s);
+static void stop_recording(RTMPSession* s);
+static int replay_init(RTMPSession* s);
+static void replay_free(RTMPSession* s);
+static void replay_push(RTMPSession* s, const AVPacket* pkt);
+static void send_packet(RTMPSession* s, AVPacket* pkt);
+static void free_renditions(RTMPSession* s);
+static int init_audio_encoder(RTMPSession* s);
+static int encode_and_send_video(RTMPSession* s, const VideoInput* in, int64_t pts);
+static int encode_rendition_frame(RTMPSession* s, const AVFrame* source, int64_t pts);
+static void enqueue_video_source(RTMPSession* s, const AVFrame* frame, int64_t pts);
+static int ring_enter(RTMPSession* s);
+static void ring_leave(RTMPSession* s);
+static int encode_and_send_audio(RTMPSession* s, const float* pcm_data, int num_samples, int64_t pts);
+static int start_encoder_thread(RTMPSession* s);
+static void stop_encoder_thread(RTMPSession* s);
+static int start_sender_thread(RTMPSession* s);
+static void stop_sender_thread(RTMPSession* s);
+static void set_async_error(RTMPSession* s, int error);
+static int frame_pool_init(RTMPSession* s);
+static void frame_pool_free(RTMPSession* s);
+static int take_async_error(RTMPSession* s);
 
-RTMP_API int rtmp_init(const RTMPConfig* config) {
-    if (config == NULL) {
-        SET_ERROR("Config is NULL");
-        return RTMP_ERROR_INVALID_PARAMS;
+static void session_init_sync(RTMPSession* s) {
+    if (!s->mutex_initialized) {
+        MUTEX_INIT(s->mutex);
+        MUTEX_INIT(s->wake_mutex);
+        MUTEX_INIT(s->recording_mutex);
+        MUTEX_INIT(s->replay_mutex);
+        MUTEX_INIT(s->sender_error_mutex);
+        COND_INIT(s->wake_cond);
+        s->mutex_initialized = 1;
+    }
+}
+
+RTMP_API RTMPSession* rtmp_session_create(void) {
+    RTMPSession* s = av_mallocz(sizeof(RTMPSession));
+    if (!s) {
+        return NULL;
     }
     
-    return rtmp_init_simple(
-        config->width,
-        config->height,
-        config->fps,
-        config->bitrate_kbps,
-        config->keyframe_interval,
-        config->audio_sample_rate,
-        config->audio_channels,
-        config->audio_bitrate_kbps
-    );
+    session_init_sync(s);
+    return s;
 }
 
-RTMP_API int rtmp_init_simple(
-    int width, 
-    int height, 
-    int fps, 
-    int bitrate_kbps,
-    int keyframe_interval,
-    int audio_sample_rate,
-    int audio_channels,
-    int audio_bitrate_kbps
-) {
+RTMP_API void rtmp_session_destroy(RTMPSession* s) {
+    if (s == NULL || s == &g_default_session) {
+        return;
+    }
+    
+    rtmp_session_cleanup(s);
+    MUTEX_DESTROY(s->mutex);
+    MUTEX_DESTROY(s->wake_mutex);
+    MUTEX_DESTROY(s->recording_mutex);
+    MUTEX_DESTROY(s->replay_mutex);
+    MUTEX_DESTROY(s->sender_error_mutex);
+    COND_DESTROY(s->wake_cond);
+    av_free(s);
+}
+
+// Fields up to audio_bitrate_kbps, the layout of the original RTMPConfig
+#define RTMP_CONFIG_BASE_SIZE offsetof(RTMPConfig, struct_size)
+
+// Copies as much of the caller's config as its struct_size covers; the rest
+// stays zero, which every field treats as its default
+static void read_config(const RTMPConfig* config, size_t size, RTMPConfig* out) {
+    memset(out, 0, sizeof(*out));
+    if (size < offsetof(RTMPConfig, struct_size) + sizeof(int)) {
+        size = RTMP_CONFIG_BASE_SIZE;
+    }
+    memcpy(out, config, FFMIN(size, sizeof(*out)));
+    out->struct_size = sizeof(*out);
+}
+
+RTMP_API int rtmp_session_init(RTMPSession* s, const RTMPConfig* caller_config) {
+    if (s == NULL) {
+        return RTMP_ERROR_INVALID_PARAMS;
+    }
+    
+    if (caller_config == NULL) {
+        SET_ERROR(s, "Config is NULL");
+        return RTMP_ERROR_INVALID_PARAMS;
+    }
+    
+    RTMPConfig full_config;
+    read_config(caller_config, caller_config->struct_size > 0 ? (size_t)caller_config->struct_size : 0, &full_config);
+    const RTMPConfig* config = &full_config;
+    
+    int width = config->width;
+    int height = config->height;
+    int fps = config->fps;
+    int bitrate_kbps = config->bitrate_kbps;
+    
     // Validate parameters
     if (width <= 0 || height <= 0 || fps <= 0 || bitrate_kbps <= 0) {
-        SET_ERROR("Invalid video parameters: %dx%d @ %dfps, %dkbps", width, height, fps, bitrate_kbps);
+        SET_ERROR(s, "Invalid video parameters: %dx%d @ %dfps, %dkbps", width, height, fps, bitrate_kbps);
         return RTMP_ERROR_INVALID_PARAMS;
     }
     
-    // Initialize mutex
-    if (!g_rtmp.mutex_initialized) {
-        MUTEX_INIT(g_rtmp.mutex);
-        g_rtmp.mutex_initialized = 1;
+    if (config->pixel_format < RTMP_PIXEL_FORMAT_RGBA || config->pixel_format > RTMP_PIXEL_FORMAT_I420) {
+        SET_ERROR(s, "Invalid pixel format: %d", config->pixel_format);
+        return RTMP_ERROR_INVALID_PARAMS;
+    }
+    
+    if (config->video_codec < RTMP_VIDEO_CODEC_H264 || config->video_codec > RTMP_VIDEO_CODEC_AV1) {
+        SET_ERROR(s, "Invalid video codec: %d", config->video_codec);
+        return RTMP_ERROR_INVALID_PARAMS;
     }
     
-    MUTEX_LOCK(g_rtmp.mutex);
+    if (config->video_codec != RTMP_VIDEO_CODEC_H264 && !RTMP_HAVE_ENHANCED_FLV) {
+        SET_ERROR(s, "%s over RTMP needs FFmpeg 6.1 or newer (enhanced RTMP)", VIDEO_CODECS[config->video_codec].name);
+        return RTMP_ERROR_INVALID_PARAMS;
+    }
+    
+    // Initialize mutex
+    session_init_sync(s);
+    
+    MUTEX_LOCK(s->mutex);
     
     // Clean up any existing state
-    if (g_rtmp.state != RTMP_STATE_IDLE) {
-        MUTEX_UNLOCK(g_rtmp.mutex);
-        rtmp_cleanup();
-        MUTEX_LOCK(g_rtmp.mutex);
+    if (s->state != RTMP_STATE_IDLE) {
+        MUTEX_UNLOCK(s->mutex);
+        rtmp_session_cleanup(s);
+        MUTEX_LOCK(s->mutex);
     }
     
     // Store configuration
-    g_rtmp.config.width = width;
-    g_rtmp.config.height = height;
-    g_rtmp.config.fps = fps;
-    g_rtmp.config.bitrate_kbps = bitrate_kbps;
-    g_rtmp.config.keyframe_interval = keyframe_interval > 0 ? keyframe_interval : 2;
-    g_rtmp.config.audio_sample_rate = audio_sample_rate > 0 ? audio_sample_rate : 44100;
-    g_rtmp.config.audio_channels = audio_channels > 0 ? audio_channels : 2;
-    g_rtmp.config.audio_bitrate_kbps = audio_bitrate_kbps > 0 ? audio_bitrate_kbps : 128;
+    s->config.width = width;
+    s->config.height = height;
+    s->config.fps = fps;
+    s->config.bitrate_kbps = bitrate_kbps;
+    s->config.keyframe_interval = config->keyframe_interval > 0 ? config->keyframe_interval : 2;
+    s->config.audio_sample_rate = config->audio_sample_rate > 0 ? config->audio_sample_rate : 44100;
+    s->config.audio_channels = config->audio_channels > 0 ? config->audio_channels : 2;
+    s->config.audio_bitrate_kbps = config->audio_bitrate_kbps > 0 ? config->audio_bitrate_kbps : 128;
+    s->config.struct_size = sizeof(RTMPConfig);
+    s->config.async_encode = config->async_encode ? 1 : 0;
+    s->config.send_queue_size = config->send_queue_size > 0 ? config->send_queue_size : RTMP_DEFAULT_SEND_QUEUE_SIZE;
+    s->config.drop_policy = config->drop_policy == RTMP_DROP_QUEUED ? RTMP_DROP_QUEUED : RTMP_DROP_NEWEST;
+    s->config.skip_policy = config->skip_policy >= RTMP_SKIP_DROP_NEWEST && config->skip_policy <= RTMP_SKIP_KEEP_LATEST
+        ? config->skip_policy : RTMP_SKIP_DROP_NEWEST;
+    s->config.flip_vertical = config->flip_vertical ? 1 : 0;
+    s->config.pixel_format = config->pixel_format;
+    s->config.video_codec = config->video_codec;
+    s->config.hardware_encode = config->hardware_encode ? 1 : 0;
+    s->config.adaptive_bitrate = config->adaptive_bitrate ? 1 : 0;
+    s->config.min_bitrate_kbps = config->min_bitrate_kbps > 0 ? FFMIN(config->min_bitrate_kbps, bitrate_kbps) : FFMAX(bitrate_kbps / 4, 1);
+    s->config.rate_control = config->rate_control >= RTMP_RATE_CONTROL_ABR && config->rate_control <= RTMP_RATE_CONTROL_CBR
+        ? config->rate_control : RTMP_RATE_CONTROL_ABR;
+    s->config.vbv_buffer_ms = config->vbv_buffer_ms > 0 ? config->vbv_buffer_ms : RTMP_DEFAULT_VBV_BUFFER_MS;
+    s->config.encoder_threads = FFMAX(config->encoder_threads, 0);
+    s->config.threading = config->threading == RTMP_THREADING_FRAME ? RTMP_THREADING_FRAME : RTMP_THREADING_SLICE;
+    s->config.replay_buffer_seconds = FFMAX(config->replay_buffer_seconds, 0);
+    s->config.reconnect_attempts = FFMAX(config->reconnect_attempts, 0);
+    ATOMIC_STORE(&s->abr.max_kbps, bitrate_kbps);
     
     // Reset statistics
-    g_rtmp.bytes_sent = 0;
-    g_rtmp.frames_sent = 0;
-    g_rtmp.dropped_frames = 0;
-    
-    // Allocate packet
-    g_rtmp.packet = av_packet_alloc();
-    if (!g_rtmp.packet) {
-        SET_ERROR("Failed to allocate packet");
-        MUTEX_UNLOCK(g_rtmp.mutex);
+    ATOMIC_STORE64(&s->bytes_sent, 0);
+    ATOMIC_STORE(&s->frames_sent, 0);
+    ATOMIC_STORE(&s->skipped_frames, 0);
+    ATOMIC_STORE(&s->avg_encode_us, 0);
+    s->next_sync_encode = 0;
+    ATOMIC_STORE(&s->pending_bitrate_kbps, 0);
+    ATOMIC_STORE(&s->keyframe_requested, 0);
+    
+    // Allocate packets
+    s->packet = av_packet_alloc();
+    s->sender_packet = av_packet_alloc();
+    s->fanout_packet = av_packet_alloc();
+    if (!s->packet || !s->sender_packet || !s->fanout_packet) {
+        SET_ERROR(s, "Failed to allocate packet");
+        MUTEX_UNLOCK(s->mutex);
         return RTMP_ERROR_ALLOC_FAILED;
     }
     
-    g_rtmp.state = RTMP_STATE_INITIALIZED;
-    g_rtmp.error_msg[0] = '\0';
+    s->state = RTMP_STATE_INITIALIZED;
+    s->error_msg[0] = '\0';
     
-    MUTEX_UNLOCK(g_rtmp.mutex);
+    MUTEX_UNLOCK(s->mutex);
     return RTMP_SUCCESS;
 }
 
-RTMP_API int rtmp_connect(const char* url) {
-    if (url == NULL || strlen(url) == 0) {
-        SET_ERROR("URL is NULL or empty");
-        return RTMP_ERROR_INVALID_PARAMS;
+static THREAD_PROC(network_open_main) {
+    NetworkOpen* net = (NetworkOpen*)arg;
+    net->ret = avio_open2(&net->pb, net->url, AVIO_FLAG_WRITE, net->interrupt, NULL);
+    THREAD_RETURN;
+}
+
+// Aborts a blocked connect once disconnect is called
+static int connect_interrupted(void* opaque) {
+    RTMPSession* s = (RTMPSession*)opaque;
+    return ATOMIC_LOAD(&s->connect_cancel);
+}
+
+// Interrupts every network step of a connect in progress, the destinations'
+// and renditions' included. Once connected the same callbacks guard the
+// live stream, so nothing is set then.
+static void cancel_connect(RTMPSession* s) {
+    MUTEX_LOCK(s->mutex);
+    if (s->state == RTMP_STATE_CONNECTING) {
+        ATOMIC_STORE(&s->connect_cancel, 1);
+        for (int i = 0; i < s->destination_count; i++) {
+            ATOMIC_STORE(&s->destinations[i].abort, 1);
+        }
     }
+    MUTEX_UNLOCK(s->mutex);
     
-    MUTEX_LOCK(g_rtmp.mutex);
-    
-    if (g_rtmp.state != RTMP_STATE_INITIALIZED) {
-        SET_ERROR("Not initialized. Call rtmp_init first.");
-        MUTEX_UNLOCK(g_rtmp.mutex);
-        return RTMP_ERROR_NOT_CONNECTED;
+    for (int i = 0; i < s->rendition_count; i++) {
+        cancel_connect(s->renditions[i].session);
     }
+}
+
+// Sets the state a connect ends in. A failed async connect stays in
+// RTMP_STATE_ERROR so rtmp_get_state can report it.
+static void finish_connect(RTMPSession* s, int ret) {
+    MUTEX_LOCK(s->mutex);
+    if (ret == RTMP_SUCCESS) {
+        s->start_time = av_gettime_relative();
+        s->state = RTMP_STATE_CONNECTED;
+    } else if (s->connect_async) {
+        s->state = RTMP_STATE_ERROR;
+    } else {
+        s->state = RTMP_STATE_INITIALIZED;
+    }
+    MUTEX_UNLOCK(s->mutex);
+    av_freep(&s->connect_url);
+}
+
+// Undoes a connect that failed before the sender thread started
+static int abort_connect(RTMPSession* s, int error) {
+    close_destinations(s);
+    if (s->format_ctx) {
+        if (s->format_ctx->pb) {
+            avio_closep(&s->format_ctx->pb);
+        }
+        avformat_free_context(s->format_ctx);
+        s->format_ctx = NULL;
+    }
+    free_video_encoder(s);
+    swr_free(&s->swr_ctx);
+    av_frame_free(&s->audio_frame);
+    avcodec_free_context(&s->audio_codec_ctx);
+    s->video_stream = NULL;
+    s->audio_stream = NULL;
     
-    int ret;
+    finish_connect(s, error);
+    return error;
+}
+
+// Undoes a connect that failed once the stream was set up
+static int fail_connected(RTMPSession* s, int error) {
+    char msg[sizeof(s->error_msg)];
+    memcpy(msg, s->error_msg, sizeof(msg));
+    disconnect_session(s);
+    memcpy(s->error_msg, msg, sizeof(msg));
+    
+    finish_connect(s, error);
+    return error;
+}
+
+// Body of rtmp_connect, and of the connect thread for rtmp_connect_async.
+// The session is in RTMP_STATE_CONNECTING, which keeps every other call
+// away, so the mutex is only held for the short steps and a send call
+// or rtmp_get_state never waits on the network. Every network step is
+// interruptible through cancel_connect.
+static int connect_session(RTMPSession* s) {
+    const char* url = s->connect_url;
     
     // Create output format context for FLV/RTMP
-    ret = avformat_alloc_output_context2(&g_rtmp.format_ctx, NULL, "flv", url);
-    if (ret < 0 || !g_rtmp.format_ctx) {
-        SET_ERROR("Failed to create output context: %s", av_err2str(ret));
-        MUTEX_UNLOCK(g_rtmp.mutex);
-        return RTMP_ERROR_INIT_FAILED;
+    int ret = avformat_alloc_output_context2(&s->format_ctx, NULL, "flv", url);
+    if (ret < 0 || !s->format_ctx) {
+        SET_ERROR(s, "Failed to create output context: %s", av_err2str(ret));
+        return abort_connect(s, RTMP_ERROR_INIT_FAILED);
     }
+    s->format_ctx->interrupt_callback.callback = connect_interrupted;
+    s->format_ctx->interrupt_callback.opaque = s;
     
-    // Initialize video encoder
-    ret = init_video_encoder();
-    if (ret != RTMP_SUCCESS) {
-        avformat_free_context(g_rtmp.format_ctx);
-        g_rtmp.format_ctx = NULL;
-        MUTEX_UNLOCK(g_rtmp.mutex);
-        return ret;
-    }
+    // Connect while the encoders open, so going live takes the longer of
+    // the two rather than their sum. Destinations shake hands alongside.
+    NetworkOpen net = { url, &s->format_ctx->interrupt_callback, NULL, 0 };
+    int needs_network = !(s->format_ctx->oformat->flags & AVFMT_NOFILE);
+    THREAD_TYPE network_thread;
+    int network_threaded = needs_network && THREAD_CREATE(network_thread, network_open_main, &net) == 0;
+    start_destination_opens(s);
     
-    // Initialize audio encoder
-    ret = init_audio_encoder();
-    if (ret != RTMP_SUCCESS) {
+    ret = init_video_encoder(s);
+    if (ret == RTMP_SUCCESS && init_audio_encoder(s) != RTMP_SUCCESS) {
         // Audio is optional, just log warning
         fprintf(stderr, "[RTMP] Warning: Audio encoder init failed, streaming video only\n");
     }
     
-    // Open network connection
-    if (!(g_rtmp.format_ctx->oformat->flags & AVFMT_NOFILE)) {
-        ret = avio_open2(&g_rtmp.format_ctx->pb, url, AVIO_FLAG_WRITE, NULL, NULL);
-        if (ret < 0) {
-            SET_ERROR("Failed to open connection to %s: %s", url, av_err2str(ret));
-            avcodec_free_context(&g_rtmp.video_codec_ctx);
-            avformat_free_context(g_rtmp.format_ctx);
-            g_rtmp.format_ctx = NULL;
-            MUTEX_UNLOCK(g_rtmp.mutex);
-            return RTMP_ERROR_CONNECT_FAILED;
+    if (ret != RTMP_SUCCESS) {
+        // No stream to send; don't wait out the handshakes
+        cancel_connect(s);
+    }
+    if (network_threaded) {
+        THREAD_JOIN(network_thread);
+    } else if (needs_network && ret == RTMP_SUCCESS) {
+        network_open_main(&net);
+    }
+    join_destination_opens(s);
+    
+    if (ret != RTMP_SUCCESS) {
+        if (net.pb) {
+            avio_closep(&net.pb);
         }
+        return abort_connect(s, ret);
     }
     
+    if (net.ret < 0) {
+        SET_ERROR(s, "Failed to open connection to %s: %s", url, av_err2str(net.ret));
+        return abort_connect(s, RTMP_ERROR_CONNECT_FAILED);
+    }
+    s->format_ctx->pb = net.pb;
+    
     // Write stream header
     AVDictionary* opts = NULL;
     av_dict_set(&opts, "flvflags", "no_duration_filesize", 0);
     
-    ret = avformat_write_header(g_rtmp.format_ctx, &opts);
+    ret = avformat_write_header(s->format_ctx, &opts);
     av_dict_free(&opts);
     
     if (ret < 0) {
-        SET_ERROR("Failed to write header: %s", av_err2str(ret));
-        avio_closep(&g_rtmp.format_ctx->pb);
-        avcodec_free_context(&g_rtmp.video_codec_ctx);
-        avformat_free_context(g_rtmp.format_ctx);
-        g_rtmp.format_ctx = NULL;
-        MUTEX_UNLOCK(g_rtmp.mutex);
-        return RTMP_ERROR_CONNECT_FAILED;
+        SET_ERROR(s, "Failed to write header: %s", av_err2str(ret));
+        return abort_connect(s, RTMP_ERROR_CONNECT_FAILED);
+    }
+    
+    // A destination that fails to open is reported on its own; the main
+    // stream goes ahead without it. Nothing is sent to them before
+    // finish_connect publishes the new state under the lock.
+    open_destinations(s);
+    
+    MUTEX_LOCK(s->mutex);
+    
+    ret = start_sender_thread(s);
+    if (ret != RTMP_SUCCESS) {
+        MUTEX_UNLOCK(s->mutex);
+        return abort_connect(s, ret);
     }
     
-    g_rtmp.start_time = av_gettime_relative();
-    g_rtmp.state = RTMP_STATE_CONNECTED;
+    ret = replay_init(s);
+    if (ret != RTMP_SUCCESS) {
+        // Sender is running; disconnect tears everything down
+        SET_ERROR(s, "Failed to allocate replay buffer");
+        MUTEX_UNLOCK(s->mutex);
+        return fail_connected(s, ret);
+    }
+    
+    MUTEX_UNLOCK(s->mutex);
+    
+    ret = connect_renditions(s);
+    if (ret != RTMP_SUCCESS) {
+        // Also disconnects the renditions that did connect
+        return fail_connected(s, ret);
+    }
     
-    MUTEX_UNLOCK(g_rtmp.mutex);
+    finish_connect(s, RTMP_SUCCESS);
     return RTMP_SUCCESS;
 }
 
-static int init_video_encoder(void) {
-    // Find H.264 encoder
-    const AVCodec* codec = avcodec_find_encoder(AV_CODEC_ID_H264);
-    if (!codec) {
-        SET_ERROR("H.264 encoder not found");
-        return RTMP_ERROR_INIT_FAILED;
+static THREAD_PROC(connect_thread_main) {
+    connect_session((RTMPSession*)arg);
+    THREAD_RETURN;
+}
+
+// Waits for an async connect to end, without cancelling it
+static void join_connect_thread(RTMPSession* s) {
+    if (s->connect_thread_started) {
+        THREAD_JOIN(s->connect_thread);
+        s->connect_thread_started = 0;
+    }
+}
+
+// Cancels an async connect still in progress and waits for it. A connect
+// that got past the network steps runs to the end.
+static void stop_connect_thread(RTMPSession* s) {
+    if (!s->connect_thread_started) {
+        return;
     }
     
-    // Create video stream
-    g_rtmp.video_stream = avformat_new_stream(g_rtmp.format_ctx, NULL);
-    if (!g_rtmp.video_stream) {
-        SET_ERROR("Failed to create video stream");
-        return RTMP_ERROR_INIT_FAILED;
+    cancel_connect(s);
+    join_connect_thread(s);
+}
+
+// Moves an initialized session, or one whose async connect failed, to
+// RTMP_STATE_CONNECTING
+static int begin_connect(RTMPSession* s, const char* url, int async) {
+    if (s == NULL || !s->mutex_initialized) {
+        return RTMP_ERROR_INVALID_PARAMS;
     }
-    g_rtmp.video_stream->id = g_rtmp.format_ctx->nb_streams - 1;
     
-    // Allocate codec context
-    g_rtmp.video_codec_ctx = avcodec_alloc_context3(codec);
-    if (!g_rtmp.video_codec_ctx) {
-        SET_ERROR("Failed to allocate video codec context");
-        return RTMP_ERROR_ALLOC_FAILED;
+    if (url == NULL || strlen(url) == 0) {
+        SET_ERROR(s, "URL is NULL or empty");
+        return RTMP_ERROR_INVALID_PARAMS;
     }
     
-    // Configure encoder
-    AVCodecContext* c = g_rtmp.video_codec_ctx;
-    c->codec_id = AV_CODEC_ID_H264;
-    c->bit_rate = g_rtmp.config.bitrate_kbps * 1000;
-    c->width = g_rtmp.config.width;
-    c->height = g_rtmp.config.height;
-    c->time_base = (AVRational){1, g_rtmp.config.fps};
-    c->framerate = (AVRational){g_rtmp.config.fps, 1};
-    c->gop_size = g_rtmp.config.fps * g_rtmp.config.keyframe_interval; // Keyframe every N seconds
-    c->max_b_frames = 0; // No B-frames for low latency
-    c->pix_fmt = AV_PIX_FMT_YUV420P;
+    // Reap a finished async connect before starting another
+    if (s->state != RTMP_STATE_CONNECTING) {
+        stop_connect_thread(s);
+    }
     
-    // Set encoder options for low latency streaming
-    av_opt_set(c->priv_data, "preset", "veryfast", 0);
-    av_opt_set(c->priv_data, "tune", "zerolatency", 0);
-    av_opt_set(c->priv_data, "profile", "main", 0);
+    MUTEX_LOCK(s->mutex);
     
-    // Global header flag for streaming
-    if (g_rtmp.format_ctx->oformat->flags & AVFMT_GLOBALHEADER) {
-        c->flags |= AV_CODEC_FLAG_GLOBAL_HEADER;
+    if (s->state == RTMP_STATE_CONNECTING) {
+        SET_ERROR(s, "Already connecting");
+        MUTEX_UNLOCK(s->mutex);
+        return RTMP_ERROR_NOT_CONNECTED;
     }
     
-    // Open encoder
-    int ret = avcodec_open2(c, codec, NULL);
-    if (ret < 0) {
-        SET_ERROR("Failed to open video encoder: %s", av_err2str(ret));
-        avcodec_free_context(&g_rtmp.video_codec_ctx);
-        return RTMP_ERROR_INIT_FAILED;
+    if (s->state != RTMP_STATE_INITIALIZED && s->state != RTMP_STATE_ERROR) {
+        SET_ERROR(s, "Not initialized. Call rtmp_init first.");
+        MUTEX_UNLOCK(s->mutex);
+        return RTMP_ERROR_NOT_CONNECTED;
     }
     
-    // Copy codec params to stream
-    ret = avcodec_parameters_from_context(g_rtmp.video_stream->codecpar, c);
-    if (ret < 0) {
-        SET_ERROR("Failed to copy codec params: %s", av_err2str(ret));
-        avcodec_free_context(&g_rtmp.video_codec_ctx);
+    s->connect_url = av_strdup(url);
+    if (!s->connect_url) {
+        SET_ERROR(s, "Failed to allocate URL");
+        MUTEX_UNLOCK(s->mutex);
+        return RTMP_ERROR_ALLOC_FAILED;
+    }
+    
+    s->connect_async = async;
+    ATOMIC_STORE(&s->connect_cancel, 0);
+    for (int i = 0; i < s->destination_count; i++) {
+        ATOMIC_STORE(&s->destinations[i].abort, 0);
+    }
+    s->error_msg[0] = '\0';
+    s->state = RTMP_STATE_CONNECTING;
+    
+    MUTEX_UNLOCK(s->mutex);
+    return RTMP_SUCCESS;
+}
+
+RTMP_API int rtmp_session_connect(RTMPSession* s, const char* url) {
+    int ret = begin_connect(s, url, 0);
+    if (ret != RTMP_SUCCESS) {
+        return ret;
+    }
+    return connect_session(s);
+}
+
+RTMP_API int rtmp_session_connect_async(RTMPSession* s, const char* url) {
+    int ret = begin_connect(s, url, 1);
+    if (ret != RTMP_SUCCESS) {
+        return ret;
+    }
+    
+    if (THREAD_CREATE(s->connect_thread, connect_thread_main, s) != 0) {
+        SET_ERROR(s, "Failed to start connect thread");
+        s->connect_async = 0;
+        finish_connect(s, RTMP_ERROR_INIT_FAILED);
         return RTMP_ERROR_INIT_FAILED;
     }
     
-    g_rtmp.video_stream->time_base = c->time_base;
+    s->connect_thread_started = 1;
+    return RTMP_SUCCESS;
+}
+
+// Row width in bytes and row count of each input plane. Returns the plane count.
+static int video_plane_layout(const RTMPSession* s, int row_bytes[3], int rows[3]) {
+    int w = s->config.width;
+    int h = s->config.height;
+    int cw = (w + 1) / 2;
+    int ch = (h + 1) / 2;
     
-    // Allocate video frame
-    g_rtmp.video_frame = av_frame_alloc();
-    if (!g_rtmp.video_frame) {
-        SET_ERROR("Failed to allocate video frame");
-        avcodec_free_context(&g_rtmp.video_codec_ctx);
-        return RTMP_ERROR_ALLOC_FAILED;
+    switch (s->config.pixel_format) {
+        case RTMP_PIXEL_FORMAT_NV12:
+            row_bytes[0] = w;      rows[0] = h;
+            row_bytes[1] = cw * 2; rows[1] = ch;
+            return 2;
+        case RTMP_PIXEL_FORMAT_I420:
+            row_bytes[0] = w;  rows[0] = h;
+            row_bytes[1] = cw; rows[1] = ch;
+            row_bytes[2] = cw; rows[2] = ch;
+            return 3;
+        default:
+            row_bytes[0] = w * 4; rows[0] = h;
+            return 1;
     }
+}
+
+// Bytes of one tightly packed frame, planes back to back
+static int video_frame_size(const RTMPSession* s) {
+    int row_bytes[3], rows[3];
+    int planes = video_plane_layout(s, row_bytes, rows);
+    int size = 0;
+    for (int i = 0; i < planes; i++) {
+        size += row_bytes[i] * rows[i];
+    }
+    return size;
+}
+
+// Splits a tightly packed frame into its planes
+static void video_input_from_buffer(const RTMPSession* s, const uint8_t* data, VideoInput* in) {
+    int row_bytes[3], rows[3];
+    int planes = video_plane_layout(s, row_bytes, rows);
     
-    g_rtmp.video_frame->format = c->pix_fmt;
-    g_rtmp.video_frame->width = c->width;
-    g_rtmp.video_frame->height = c->height;
+    memset(in, 0, sizeof(*in));
+    for (int i = 0; i < planes; i++) {
+        in->data[i] = data;
+        in->stride[i] = row_bytes[i];
+        data += (size_t)row_bytes[i] * rows[i];
+    }
+}
+
+#ifdef RTMP_VERIFY_COLORCONV
+static enum AVPixelFormat packed_av_format(int pixel_format) {
+    switch (pixel_format) {
+        case RTMP_PIXEL_FORMAT_RGBA: return AV_PIX_FMT_RGBA;
+        case RTMP_PIXEL_FORMAT_BGRA: return AV_PIX_FMT_BGRA;
+        case RTMP_PIXEL_FORMAT_ARGB: return AV_PIX_FMT_ARGB;
+        default: return AV_PIX_FMT_NONE;
+    }
+}
+#endif
+
+// Sets the bitrate and, for VBV/CBR, the peak rate and buffer that follow it.
+// Once the encoder is open only encoder_reconfigures_bitrate() ones pick
+// changes up, on the next frame.
+static void set_video_rate(RTMPSession* s, AVCodecContext* c, int bitrate_kbps) {
+    c->bit_rate = (int64_t)bitrate_kbps * 1000;
+    if (s->config.rate_control != RTMP_RATE_CONTROL_ABR) {
+        c->rc_max_rate = c->bit_rate;
+        c->rc_buffer_size = (int)FFMIN(c->bit_rate * s->config.vbv_buffer_ms / 1000, INT32_MAX);
+    }
+}
+
+static int encoder_supports_pix_fmt(const AVCodec* codec, enum AVPixelFormat fmt) {
+    for (const enum AVPixelFormat* p = codec->pix_fmts; p && *p != AV_PIX_FMT_NONE; p++) {
+        if (*p == fmt) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+// Low latency defaults per encoder; rtmp_set_encoder_option overrides them.
+// Options an encoder does not have are ignored here.
+static int has_suffix(const char* str, const char* suffix) {
+    size_t len = strlen(str);
+    size_t suffix_len = strlen(suffix);
+    return len >= suffix_len && strcmp(str + len - suffix_len, suffix) == 0;
+}
+
+static void set_video_encoder_defaults(RTMPSession* s, AVCodecContext* c, const AVCodec* codec) {
+    if (has_suffix(codec->name, "_nvenc")) {
+        av_opt_set(c->priv_data, "preset", "p4", 0);
+        av_opt_set(c->priv_data, "tune", "ll", 0);
+        av_opt_set(c->priv_data, "zerolatency", "1", 0);
+        av_opt_set(c->priv_data, "forced-idr", "1", 0);
+        if (s->config.rate_control == RTMP_RATE_CONTROL_CBR) {
+            av_opt_set(c->priv_data, "rc", "cbr", 0);
+        }
+    } else if (has_suffix(codec->name, "_vaapi")) {
+        // One frame in flight instead of a queue of them
+        av_opt_set(c->priv_data, "async_depth", "1", 0);
+    } else if (has_suffix(codec->name, "_videotoolbox")) {
+        av_opt_set(c->priv_data, "realtime", "1", 0);
+    } else if (has_suffix(codec->name, "_mediacodec")) {
+        av_opt_set(c->priv_data, "bitrate_mode", s->config.rate_control == RTMP_RATE_CONTROL_CBR ? "cbr" : "vbr", 0);
+    } else if (strcmp(codec->name, "libx265") == 0) {
+        av_opt_set(c->priv_data, "preset", "superfast", 0);
+        av_opt_set(c->priv_data, "tune", "zerolatency", 0);
+        av_opt_set(c->priv_data, "profile", "main", 0);
+        av_opt_set(c->priv_data, "forced-idr", "1", 0);
+    } else if (strcmp(codec->name, "libsvtav1") == 0) {
+        // 10+ are the realtime presets
+        av_opt_set(c->priv_data, "preset", "10", 0);
+        if (s->config.rate_control != RTMP_RATE_CONTROL_ABR) {
+            // Low delay prediction, which SVT-AV1 only allows with CBR (maxrate == bitrate)
+            av_opt_set(c->priv_data, "svtav1-params", "pred-struct=1", 0);
+        }
+    } else if (strcmp(codec->name, "libaom-av1") == 0) {
+        av_opt_set(c->priv_data, "usage", "realtime", 0);
+        av_opt_set(c->priv_data, "cpu-used", "8", 0);
+        av_opt_set(c->priv_data, "lag-in-frames", "0", 0);
+        av_opt_set(c->priv_data, "row-mt", "1", 0);
+    } else {
+        av_opt_set(c->priv_data, "preset", "veryfast", 0);
+        av_opt_set(c->priv_data, "tune", "zerolatency", 0);
+        av_opt_set(c->priv_data, "profile", "main", 0);
+        // Forced keyframes (rtmp_request_keyframe) must be IDRs so viewers can join on them
+        av_opt_set(c->priv_data, "forced-idr", "1", 0);
+        if (s->config.rate_control == RTMP_RATE_CONTROL_CBR) {
+            // Pad with filler data so the output never falls below the target rate
+            av_opt_set(c->priv_data, "nal-hrd", "cbr", 0);
+        }
+    }
+}
+
+// libx264 compares bit_rate on every frame and reconfigures its rate control
+// (including VBV) in place; NVENC does the same on GPUs with dynamic bitrate
+// support. Every other encoder keeps the rate it was opened with.
+static int encoder_reconfigures_bitrate(const char* name) {
+    return strcmp(name, "libx264") == 0 || has_suffix(name, "_nvenc");
+}
+
+// Software layout the encoder is fed. NV12 input stays NV12 where the
+// encoder takes it, everything else is I420 unless the encoder only takes NV12.
+static enum AVPixelFormat encoder_sw_format(RTMPSession* s, const AVCodec* codec, const HardwareEncoder* hw) {
+    if (hw && hw->device != AV_HWDEVICE_TYPE_NONE) {
+        return AV_PIX_FMT_NV12; // device surfaces
+    }
     
-    ret = av_frame_get_buffer(g_rtmp.video_frame, 0);
+    int nv12 = encoder_supports_pix_fmt(codec, AV_PIX_FMT_NV12);
+    if (s->config.pixel_format == RTMP_PIXEL_FORMAT_NV12 && nv12) {
+        return AV_PIX_FMT_NV12;
+    }
+    if (!codec->pix_fmts || encoder_supports_pix_fmt(codec, AV_PIX_FMT_YUV420P)) {
+        return AV_PIX_FMT_YUV420P;
+    }
+    return nv12 ? AV_PIX_FMT_NV12 : AV_PIX_FMT_NONE;
+}
+
+// Opens the device and a frame pool on it; c->pix_fmt becomes the device format
+static int init_hw_frames(RTMPSession* s, AVCodecContext* c, const HardwareEncoder* hw) {
+    int ret = av_hwdevice_ctx_create(&s->hw_device_ctx, hw->device, NULL, NULL, 0);
     if (ret < 0) {
-        SET_ERROR("Failed to allocate video frame buffer: %s", av_err2str(ret));
-        av_frame_free(&g_rtmp.video_frame);
-        avcodec_free_context(&g_rtmp.video_codec_ctx);
+        SET_ERROR(s, "No %s device: %s", av_hwdevice_get_type_name(hw->device), av_err2str(ret));
+        return RTMP_ERROR_INIT_FAILED;
+    }
+    
+    AVBufferRef* frames_ref = av_hwframe_ctx_alloc(s->hw_device_ctx);
+    if (!frames_ref) {
+        SET_ERROR(s, "Failed to allocate %s frames", av_hwdevice_get_type_name(hw->device));
         return RTMP_ERROR_ALLOC_FAILED;
     }
     
-    // Create scaler for RGBA -> YUV420P conversion
-    g_rtmp.sws_ctx = sws_getContext(
-        g_rtmp.config.width, g_rtmp.config.height, AV_PIX_FMT_RGBA,
-        c->width, c->height, AV_PIX_FMT_YUV420P,
-        SWS_BILINEAR, NULL, NULL, NULL
-    );
+    AVHWFramesContext* frames = (AVHWFramesContext*)frames_ref->data;
+    frames->format = hw->hw_format;
+    frames->sw_format = c->pix_fmt;
+    frames->width = c->width;
+    frames->height = c->height;
     
-    if (!g_rtmp.sws_ctx) {
-        SET_ERROR("Failed to create scaler context");
-        av_frame_free(&g_rtmp.video_frame);
-        avcodec_free_context(&g_rtmp.video_codec_ctx);
+    ret = av_hwframe_ctx_init(frames_ref);
+    if (ret < 0) {
+        SET_ERROR(s, "Failed to create %s frames: %s", av_hwdevice_get_type_name(hw->device), av_err2str(ret));
+        av_buffer_unref(&frames_ref);
         return RTMP_ERROR_INIT_FAILED;
     }
     
+    c->hw_frames_ctx = frames_ref;
+    c->pix_fmt = hw->hw_format;
     return RTMP_SUCCESS;
 }
 
-static int init_audio_encoder(void) {
-    // Find AAC encoder
-    const AVCodec* codec = avcodec_find_encoder(AV_CODEC_ID_AAC);
-    if (!codec) {
-        SET_ERROR("AAC encoder not found");
-        return RTMP_ERROR_INIT_FAILED;
-    }
-    
-    // Create audio stream
-    g_rtmp.audio_stream = avformat_new_stream(g_rtmp.format_ctx, NULL);
-    if (!g_rtmp.audio_stream) {
-        SET_ERROR("Failed to create audio stream");
+// Configures and opens one encoder as s->video_codec_ctx. On failure
+// everything it allocated is freed again and error_msg says why.
+static int open_video_encoder(RTMPSession* s, const VideoCodecInfo* info, const AVCodec* codec, const HardwareEncoder* hw, int global_header) {
+    enum AVPixelFormat sw_format = encoder_sw_format(s, codec, hw);
+    if (sw_format == AV_PIX_FMT_NONE) {
+        SET_ERROR(s, "%s takes neither I420 nor NV12 frames", codec->name);
         return RTMP_ERROR_INIT_FAILED;
     }
-    g_rtmp.audio_stream->id = g_rtmp.format_ctx->nb_streams - 1;
     
     // Allocate codec context
-    g_rtmp.audio_codec_ctx = avcodec_alloc_context3(codec);
-    if (!g_rtmp.audio_codec_ctx) {
-        SET_ERROR("Failed to allocate audio codec context");
+    s->video_codec_ctx = avcodec_alloc_context3(codec);
+    if (!s->video_codec_ctx) {
+        SET_ERROR(s, "Failed to allocate video codec context");
         return RTMP_ERROR_ALLOC_FAILED;
     }
     
     // Configure encoder
-    AVCodecContext* c = g_rtmp.audio_codec_ctx;
-    c->codec_id = AV_CODEC_ID_AAC;
-    c->bit_rate = g_rtmp.config.audio_bitrate_kbps * 1000;
-    c->sample_rate = g_rtmp.config.audio_sample_rate;
+    AVCodecContext* c = s->video_codec_ctx;
+    c->codec_id = info->id;
+    set_video_rate(s, c, s->config.bitrate_kbps);
+    c->width = s->config.width;
+    c->height = s->config.height;
+    c->time_base = (AVRational){1, s->config.fps};
+    c->framerate = (AVRational){s->config.fps, 1};
+    c->gop_size = s->config.fps * s->config.keyframe_interval; // Keyframe every N seconds
+    c->max_b_frames = 0; // No B-frames for low latency
     
-    // Set channel layout
-    av_channel_layout_default(&c->ch_layout, g_rtmp.config.audio_channels);
+    // libx264's own defaults already pick the thread count and keep the sliced
+    // threads zerolatency asks for. Setting both here caps the automatic count
+    // at RTMP_MAX_AUTO_THREADS, applies encoder_threads / threading and keeps
+    // what was asked for reportable. Slice threads split each frame across
+    // cores without adding delay; frame threads add a frame of latency each.
+    c->thread_count = s->config.encoder_threads > 0 ? s->config.encoder_threads : FFMIN(av_cpu_count(), RTMP_MAX_AUTO_THREADS);
+    c->thread_type = s->config.threading == RTMP_THREADING_FRAME ? FF_THREAD_FRAME : FF_THREAD_SLICE;
+    c->pix_fmt = sw_format;
     
-    c->sample_fmt = AV_SAMPLE_FMT_FLTP; // AAC requires planar float
-    c->time_base = (AVRational){1, c->sample_rate};
+    if (hw && hw->device != AV_HWDEVICE_TYPE_NONE) {
+        int ret = init_hw_frames(s, c, hw);
+        if (ret != RTMP_SUCCESS) {
+            free_video_encoder(s);
+            return ret;
+        }
+    }
+    
+    set_video_encoder_defaults(s, c, codec);
     
-    if (g_rtmp.format_ctx->oformat->flags & AVFMT_GLOBALHEADER) {
+    // Global header flag for streaming
+    if (global_header) {
         c->flags |= AV_CODEC_FLAG_GLOBAL_HEADER;
     }
     
-    // Open encoder
-    int ret = avcodec_open2(c, codec, NULL);
+    // Open encoder. Caller options are applied on top of everything above;
+    // avcodec_open2 removes the ones it consumed from the copy.
+    AVDictionary* opts = NULL;
+    av_dict_copy(&opts, s->encoder_options, 0);
+    int ret = avcodec_open2(c, codec, &opts);
     if (ret < 0) {
-        SET_ERROR("Failed to open audio encoder: %s", av_err2str(ret));
-        avcodec_free_context(&g_rtmp.audio_codec_ctx);
-        g_rtmp.audio_codec_ctx = NULL;
+        SET_ERROR(s, "Failed to open video encoder: %s", av_err2str(ret));
+        av_dict_free(&opts);
+        free_video_encoder(s);
         return RTMP_ERROR_INIT_FAILED;
     }
     
-    // Copy codec params to stream
-    ret = avcodec_parameters_from_context(g_rtmp.audio_stream->codecpar, c);
-    if (ret < 0) {
-        SET_ERROR("Failed to copy audio codec params: %s", av_err2str(ret));
-        avcodec_free_context(&g_rtmp.audio_codec_ctx);
-        g_rtmp.audio_codec_ctx = NULL;
-        return RTMP_ERROR_INIT_FAILED;
+    // A misspelled option would otherwise be ignored silently
+    AVDictionaryEntry* unused = av_dict_get(opts, "", NULL, AV_DICT_IGNORE_SUFFIX);
+    if (unused) {
+        SET_ERROR(s, "Unknown encoder option: %s=%s", unused->key, unused->value);
+        av_dict_free(&opts);
+        free_video_encoder(s);
+        return RTMP_ERROR_INVALID_PARAMS;
     }
-    
-    g_rtmp.audio_stream->time_base = c->time_base;
-    
-    // Allocate audio frame
-    g_rtmp.audio_frame = av_frame_alloc();
-    if (!g_rtmp.audio_frame) {
-        SET_ERROR("Failed to allocate audio frame");
-        avcodec_free_context(&g_rtmp.audio_codec_ctx);
-        g_rtmp.audio_codec_ctx = NULL;
-        return RTMP_ERROR_ALLOC_FAILED;
+    av_dict_free(&opts);
+    return RTMP_SUCCESS;
+}
+
+static void add_encoder_probe(RTMPSession* s, const char* name, const char* result) {
+    size_t len = strlen(s->encoder_probe);
+    snprintf(s->encoder_probe + len, sizeof(s->encoder_probe) - len, "%s%s: %s", len ? "; " : "", name, result);
+}
+
+static int try_video_encoder(RTMPSession* s, const VideoCodecInfo* info, const char* name, const AVCodec* codec, const HardwareEncoder* hw, int global_header) {
+    if (!codec) {
+        SET_ERROR(s, "%s encoder not found", name);
+        add_encoder_probe(s, name, "not built");
+        return RTMP_ERROR_INIT_FAILED;
     }
     
-    g_rtmp.audio_frame->format = c->sample_fmt;
-    av_channel_layout_copy(&g_rtmp.audio_frame->ch_layout, &c->ch_layout);
-    g_rtmp.audio_frame->sample_rate = c->sample_rate;
-    g_rtmp.audio_frame->nb_samples = c->frame_size;
-    
-    ret = av_frame_get_buffer(g_rtmp.audio_frame, 0);
-    if (ret < 0) {
-        SET_ERROR("Failed to allocate audio frame buffer: %s", av_err2str(ret));
-        av_frame_free(&g_rtmp.audio_frame);
-        avcodec_free_context(&g_rtmp.audio_codec_ctx);
-        g_rtmp.audio_codec_ctx = NULL;
-        return RTMP_ERROR_ALLOC_FAILED;
+    int ret = open_video_encoder(s, info, codec, hw, global_header);
+    add_encoder_probe(s, codec->name, ret == RTMP_SUCCESS ? "ok" : s->error_msg);
+    if (ret == RTMP_SUCCESS) {
+        snprintf(s->video_encoder, sizeof(s->video_encoder), "%s", codec->name);
+        s->encoder_hardware = hw != NULL;
+        s->encoder_runtime_bitrate = encoder_reconfigures_bitrate(codec->name);
     }
-    
-    // Create resampler for interleaved float -> planar float
-    g_rtmp.swr_ctx = swr_alloc();
-    if (!g_rtmp.swr_ctx) {
-        SET_ERROR("Failed to allocate resampler");
-        av_frame_free(&g_rtmp.audio_frame);
-        avcodec_free_context(&g_rtmp.audio_codec_ctx);
-        g_rtmp.audio_codec_ctx = NULL;
-        return RTMP_ERROR_ALLOC_FAILED;
+    return ret;
+}
+
+static int is_listed_encoder(const VideoCodecInfo* info, const char* name) {
+    for (const HardwareEncoder* hw = info->hardware; hw->name; hw++) {
+        if (strcmp(hw->name, name) == 0) {
+            return 1;
+        }
+    }
+    for (int i = 0; info->encoders[i]; i++) {
+        if (strcmp(info->encoders[i], name) == 0) {
+            return 1;
+        }
     }
+    return 0;
+}
+
+// Opens the first encoder that works, in VIDEO_CODECS order, recording each
+// attempt in encoder_probe. The error of the last attempt is kept on failure.
+static int select_video_encoder(RTMPSession* s, int global_header) {
+    const VideoCodecInfo* info = &VIDEO_CODECS[s->config.video_codec];
+    int ret = RTMP_ERROR_INIT_FAILED;
     
-    AVChannelLayout in_layout;
-    av_channel_layout_default(&in_layout, g_rtmp.config.audio_channels);
+    s->video_encoder[0] = '\0';
+    s->encoder_probe[0] = '\0';
+    s->encoder_hardware = 0;
+    s->encoder_runtime_bitrate = 0;
     
-    av_opt_set_chlayout(g_rtmp.swr_ctx, "in_chlayout", &in_layout, 0);
-    av_opt_set_chlayout(g_rtmp.swr_ctx, "out_chlayout", &c->ch_layout, 0);
-    av_opt_set_int(g_rtmp.swr_ctx, "in_sample_rate", g_rtmp.config.audio_sample_rate, 0);
-    av_opt_set_int(g_rtmp.swr_ctx, "out_sample_rate", c->sample_rate, 0);
-    av_opt_set_sample_fmt(g_rtmp.swr_ctx, "in_sample_fmt", AV_SAMPLE_FMT_FLT, 0); // Unity uses float
-    av_opt_set_sample_fmt(g_rtmp.swr_ctx, "out_sample_fmt", AV_SAMPLE_FMT_FLTP, 0);
+    if (s->config.hardware_encode) {
+        for (const HardwareEncoder* hw = info->hardware; hw->name && ret != RTMP_SUCCESS; hw++) {
+            ret = try_video_encoder(s, info, hw->name, avcodec_find_encoder_by_name(hw->name), hw, global_header);
+        }
+    }
     
-    ret = swr_init(g_rtmp.swr_ctx);
-    if (ret < 0) {
-        SET_ERROR("Failed to init resampler: %s", av_err2str(ret));
-        swr_free(&g_rtmp.swr_ctx);
-        av_frame_free(&g_rtmp.audio_frame);
-        avcodec_free_context(&g_rtmp.audio_codec_ctx);
-        g_rtmp.audio_codec_ctx = NULL;
-        return RTMP_ERROR_INIT_FAILED;
+    for (int i = 0; info->encoders[i] && ret != RTMP_SUCCESS; i++) {
+        const char* name = info->encoders[i];
+        ret = try_video_encoder(s, info, name, avcodec_find_encoder_by_name(name), NULL, global_header);
     }
     
-    av_channel_layout_uninit(&in_layout);
+    if (ret != RTMP_SUCCESS) {
+        const AVCodec* codec = avcodec_find_encoder(info->id);
+        if (!codec || !is_listed_encoder(info, codec->name)) {
+            ret = try_video_encoder(s, info, info->name, codec, NULL, global_header);
+        }
+    }
     
-    return RTMP_SUCCESS;
+    if (ret == RTMP_SUCCESS) {
+        s->error_msg[0] = '\0';
+    }
+    return ret;
 }
 
-RTMP_API int rtmp_start_streaming(void) {
-    MUTEX_LOCK(g_rtmp.mutex);
+static AVFrame* alloc_video_frame(enum AVPixelFormat format, int width, int height) {
+    AVFrame* frame = av_frame_alloc();
+    if (!frame) {
+        return NULL;
+    }
     
-    if (g_rtmp.state != RTMP_STATE_CONNECTED) {
-        SET_ERROR("Not connected. Call rtmp_connect first.");
-        MUTEX_UNLOCK(g_rtmp.mutex);
-        return RTMP_ERROR_NOT_CONNECTED;
+    frame->format = format;
+    frame->width = width;
+    frame->height = height;
+    if (av_frame_get_buffer(frame, 0) < 0) {
+        av_frame_free(&frame);
     }
+    return frame;
+}
+
+// Frees the encoder and its frames; safe on a partly opened encoder
+static void free_video_encoder(RTMPSession* s) {
+    sws_freeContext(s->source_sws);
+    s->source_sws = NULL;
+    av_frame_free(&s->video_frame);
+    av_frame_free(&s->upload_frame);
+    av_frame_free(&s->hw_frame);
+    avcodec_free_context(&s->video_codec_ctx);
+    av_buffer_unref(&s->hw_device_ctx);
+}
+
+// Connects every rendition at once, each on its own connect thread, and
+// waits for all of them. cancel_connect on the parent reaches them too.
+static int connect_renditions(RTMPSession* s) {
+    int ret = RTMP_SUCCESS;
+    int started = 0;
     
-    g_rtmp.state = RTMP_STATE_STREAMING;
-    g_rtmp.start_time = av_gettime_relative();
+    for (; started < s->rendition_count; started++) {
+        Rendition* r = &s->renditions[started];
+        // Same encoder options as the main stream
+        av_dict_free(&r->session->encoder_options);
+        av_dict_copy(&r->session->encoder_options, s->encoder_options, 0);
+        
+        ret = rtmp_session_connect_async(r->session, r->url);
+        if (ret != RTMP_SUCCESS) {
+            SET_ERROR(s, "Rendition %dx%d: %s", r->session->config.width, r->session->config.height, r->session->error_msg);
+            break;
+        }
+        // A cancel that came before this rendition was connecting
+        if (ATOMIC_LOAD(&s->connect_cancel)) {
+            cancel_connect(r->session);
+        }
+    }
     
-    MUTEX_UNLOCK(g_rtmp.mutex);
-    return RTMP_SUCCESS;
+    for (int i = 0; i < started; i++) {
+        RTMPSession* r = s->renditions[i].session;
+        if (ret != RTMP_SUCCESS) {
+            // One failed; the others needn't finish their handshakes
+            cancel_connect(r);
+        }
+        join_connect_thread(r);
+        
+        // The connect thread has ended, so its state is settled
+        if (ret == RTMP_SUCCESS && r->state != RTMP_STATE_CONNECTED) {
+            SET_ERROR(s, "Rendition %dx%d: %s", r->config.width, r->config.height, r->error_msg);
+            ret = RTMP_ERROR_CONNECT_FAILED;
+        }
+    }
+    return ret;
 }
 
-RTMP_API int rtmp_send_video_frame(const uint8_t* rgba_data, int data_size, int64_t pts) {
-    if (rgba_data == NULL) {
-        SET_ERROR("RGBA data is NULL");
-        return RTMP_ERROR_INVALID_PARAMS;
+static void free_renditions(RTMPSession* s) {
+    for (int i = 0; i < s->rendition_count; i++) {
+        rtmp_session_destroy(s->renditions[i].session);
+        av_freep(&s->renditions[i].url);
+        s->renditions[i].session = NULL;
     }
-    
-    int expected_size = g_rtmp.config.width * g_rtmp.config.height * 4;
-    if (data_size != expected_size) {
-        SET_ERROR("Invalid data size: expected %d, got %d", expected_size, data_size);
-        return RTMP_ERROR_INVALID_PARAMS;
+    s->rendition_count = 0;
+}
+
+// Hands each streaming rendition a reference to the converted frame. No
+// pixels are copied or scaled here; that happens on the renditions' threads.
+static void feed_renditions(RTMPSession* s, int64_t pts) {
+    for (int i = 0; i < s->rendition_count; i++) {
+        RTMPSession* r = s->renditions[i].session;
+        if (!ring_enter(r)) {
+            continue; // not streaming
+        }
+        enqueue_video_source(r, s->video_frame, pts);
+        ring_leave(r);
+    }
+}
+
+static int init_video_encoder(RTMPSession* s) {
+    int ret = select_video_encoder(s, (s->format_ctx->oformat->flags & AVFMT_GLOBALHEADER) != 0);
+    if (ret != RTMP_SUCCESS) {
+        return ret;
     }
+    AVCodecContext* c = s->video_codec_ctx;
     
-    MUTEX_LOCK(g_rtmp.mutex);
+    // Report what the encoder ended up with, encoder options included
+    s->encoder_threads = c->thread_count;
+    s->encoder_threading = c->thread_type == FF_THREAD_FRAME ? RTMP_THREADING_FRAME : RTMP_THREADING_SLICE;
     
-    if (g_rtmp.state != RTMP_STATE_STREAMING) {
-        SET_ERROR("Not streaming");
-        MUTEX_UNLOCK(g_rtmp.mutex);
-        return RTMP_ERROR_NOT_CONNECTED;
+    // Create video stream
+    s->video_stream = avformat_new_stream(s->format_ctx, NULL);
+    if (!s->video_stream) {
+        SET_ERROR(s, "Failed to create video stream");
+        free_video_encoder(s);
+        return RTMP_ERROR_INIT_FAILED;
     }
+    s->video_stream->id = s->format_ctx->nb_streams - 1;
     
-    int ret = encode_and_send_video(rgba_data, pts);
+    // Copy codec params to stream
+    ret = avcodec_parameters_from_context(s->video_stream->codecpar, c);
+    if (ret < 0) {
+        SET_ERROR(s, "Failed to copy codec params: %s", av_err2str(ret));
+        free_video_encoder(s);
+        return RTMP_ERROR_INIT_FAILED;
+    }
     
-    MUTEX_UNLOCK(g_rtmp.mutex);
-    return ret;
-}
-
-static int encode_and_send_video(const uint8_t* rgba_data, int64_t pts) {
-    int ret;
+    s->video_stream->time_base = c->time_base;
     
-    // Make frame writable
-    ret = av_frame_make_writable(g_rtmp.video_frame);
-    if (ret < 0) {
-        SET_ERROR("Failed to make frame writable: %s", av_err2str(ret));
-        return RTMP_ERROR_ENCODE_FAILED;
+    // Input is converted into video_frame: NV12 if the encoder takes the NV12
+    // input as is, I420 otherwise
+    enum AVPixelFormat sw_format = c->hw_frames_ctx ? ((AVHWFramesContext*)c->hw_frames_ctx->data)->sw_format : c->pix_fmt;
+    enum AVPixelFormat frame_format = s->config.pixel_format == RTMP_PIXEL_FORMAT_NV12 && sw_format == AV_PIX_FMT_NV12
+        ? AV_PIX_FMT_NV12 : AV_PIX_FMT_YUV420P;
+    
+    s->video_frame = alloc_video_frame(frame_format, c->width, c->height);
+    if (sw_format != frame_format) {
+        s->upload_frame = alloc_video_frame(sw_format, c->width, c->height);
+    }
+    if (c->hw_frames_ctx) {
+        s->hw_frame = av_frame_alloc();
+    }
+    
+    if (!s->video_frame || (sw_format != frame_format && !s->upload_frame) || (c->hw_frames_ctx && !s->hw_frame)) {
+        SET_ERROR(s, "Failed to allocate video frame");
+        free_video_encoder(s);
+        return RTMP_ERROR_ALLOC_FAILED;
     }
     
-    // Convert RGBA to YUV420P
-    const uint8_t* src_data[1] = { rgba_data };
-    int src_linesize[1] = { g_rtmp.config.width * 4 };
+    // Packed RGB -> YUV420P uses the SIMD kernels in ffmpeg_rtmp_colorconv.c
+    rtmp_colorconv_init();
     
-    sws_scale(
-        g_rtmp.sws_ctx,
-        src_data, src_linesize, 0, g_rtmp.config.height,
-        g_rtmp.video_frame->data, g_rtmp.video_frame->linesize
-    );
+#ifdef RTMP_VERIFY_COLORCONV
+    // Reference swscale conversion, compared against every frame
+    enum AVPixelFormat src_fmt = packed_av_format(s->config.pixel_format);
+    if (src_fmt == AV_PIX_FMT_NONE) {
+        return RTMP_SUCCESS;
+    }
     
-    // Set PTS
-    g_rtmp.video_frame->pts = av_rescale_q(
-        pts,
-        (AVRational){1, 1000}, // Input is in milliseconds
-        g_rtmp.video_codec_ctx->time_base
+    s->sws_ctx = sws_getContext(
+        s->config.width, s->config.height, src_fmt,
+        c->width, c->height, AV_PIX_FMT_YUV420P,
+        SWS_BILINEAR | SWS_ACCURATE_RND, NULL, NULL, NULL
     );
+    s->verify_frame = av_frame_alloc();
+    s->verify_max_diff = -1;
     
-    // Send frame to encoder
-    ret = avcodec_send_frame(g_rtmp.video_codec_ctx, g_rtmp.video_frame);
-    if (ret < 0) {
-        SET_ERROR("Failed to send frame to encoder: %s", av_err2str(ret));
-        return RTMP_ERROR_ENCODE_FAILED;
+    if (!s->sws_ctx || !s->verify_frame) {
+        SET_ERROR(s, "Failed to create verification scaler");
+        sws_freeContext(s->sws_ctx);
+        s->sws_ctx = NULL;
+        av_frame_free(&s->verify_frame);
+        free_video_encoder(s);
+        return RTMP_ERROR_INIT_FAILED;
     }
     
-    // Receive and write encoded packets
-    while (ret >= 0) {
-        ret = avcodec_receive_packet(g_rtmp.video_codec_ctx, g_rtmp.packet);
-        if (ret == AVERROR(EAGAIN) || ret == AVERROR_EOF) {
-            break;
-        } else if (ret < 0) {
-            SET_ERROR("Error receiving packet: %s", av_err2str(ret));
-            return RTMP_ERROR_ENCODE_FAILED;
-        }
-        
-        // Rescale timestamps
-        av_packet_rescale_ts(g_rtmp.packet, g_rtmp.video_codec_ctx->time_base, g_rtmp.video_stream->time_base);
-        g_rtmp.packet->stream_index = g_rtmp.video_stream->index;
-        
-        // Write packet
-        ret = av_interleaved_write_frame(g_rtmp.format_ctx, g_rtmp.packet);
-        if (ret < 0) {
-            SET_ERROR("Failed to write video packet: %s", av_err2str(ret));
-            av_packet_unref(g_rtmp.packet);
-            g_rtmp.dropped_frames++;
-            return RTMP_ERROR_SEND_FAILED;
-        }
-        
-        g_rtmp.bytes_sent += g_rtmp.packet->size;
-        av_packet_unref(g_rtmp.packet);
-    }
+    s->verify_frame->format = AV_PIX_FMT_YUV420P;
+    s->verify_frame->width = c->width;
+    s->verify_frame->height = c->height;
+    av_frame_get_buffer(s->verify_frame, 0);
+#endif
     
-    g_rtmp.frames_sent++;
     return RTMP_SUCCESS;
 }
 
-RTMP_API int rtmp_send_audio(const float* pcm_data, int num_samples, int64_t pts) {
-    if (pcm_data == NULL || num_samples <= 0) {
-        return RTMP_ERROR_INVALID_PARAMS;
+static int init_audio_encoder(RTMPSession* s) {
+    // Find AAC encoder
+    const AVCodec* codec = avcodec_find_encoder(AV_CODEC_ID_AAC);
+    if (!codec) {
+        SET_ERROR(s, "AAC encoder not found");
+        return RTMP_ERROR_INIT_FAILED;
     }
     
-    MUTEX_LOCK(g_rtmp.mutex);
+    // Create audio stream
+    s->audio_stream = avformat_new_stream(s->format_ctx, NULL);
+    if (!s->audio_stream) {
+        SET_ERROR(s, "Failed to create audio stream");
+        return RTMP_ERROR_INIT_FAILED;
+    }
+    s->audio_stream->id = s->format_ctx->nb_streams - 1;
     
-    if (g_rtmp.state != RTMP_STATE_STREAMING || !g_rtmp.audio_codec_ctx) {
-        MUTEX_UNLOCK(g_rtmp.mutex);
-        return RTMP_SUCCESS; // Audio is optional
+    // Allocate codec context
+    s->audio_codec_ctx = avcodec_alloc_context3(codec);
+    if (!s->audio_codec_ctx) {
+        SET_ERROR(s, "Failed to allocate audio codec context");
+        return RTMP_ERROR_ALLOC_FAILED;
     }
     
-    int ret = encode_and_send_audio(pcm_data, num_samples, pts);
+    // Configure encoder
+    AVCodecContext* c = s->audio_codec_ctx;
+    c->codec_id = AV_CODEC_ID_AAC;
+    c->bit_rate = s->config.audio_bitrate_kbps * 1000;
+    c->sample_rate = s->config.audio_sample_rate;
     
-    MUTEX_UNLOCK(g_rtmp.mutex);
-    return ret;
-}
-
-static int encode_and_send_audio(const float* pcm_data, int num_samples, int64_t pts) {
-    int ret;
+    // Set channel layout
+    av_channel_layout_default(&c->ch_layout, s->config.audio_channels);
     
-    // Make frame writable
-    ret = av_frame_make_writable(g_rtmp.audio_frame);
+    c->sample_fmt = AV_SAMPLE_FMT_FLTP; // AAC requires planar float
+    c->time_base = (AVRational){1, c->sample_rate};
+    
+    if (s->format_ctx->oformat->flags & AVFMT_GLOBALHEADER) {
+        c->flags |= AV_CODEC_FLAG_GLOBAL_HEADER;
+    }
+    
+    // Open encoder
+    int ret = avcodec_open2(c, codec, NULL);
     if (ret < 0) {
-        return RTMP_ERROR_ENCODE_FAILED;
+        SET_ERROR(s, "Failed to open audio encoder: %s", av_err2str(ret));
+        avcodec_free_context(&s->audio_codec_ctx);
+        s->audio_codec_ctx = NULL;
+        return RTMP_ERROR_INIT_FAILED;
     }
     
-    // Resample audio
-    const uint8_t* in_data[1] = { (const uint8_t*)pcm_data };
+    // Copy codec params to stream
+    ret = avcodec_parameters_from_context(s->audio_stream->codecpar, c);
+    if (ret < 0) {
+        SET_ERROR(s, "Failed to copy audio codec params: %s", av_err2str(ret));
+        avcodec_free_context(&s->audio_codec_ctx);
+        s->audio_codec_ctx = NULL;
+        return RTMP_ERROR_INIT_FAILED;
+    }
     
-    ret = swr_convert(
-        g_rtmp.swr_ctx,
-        g_rtmp.audio_frame->data,
-        g_rtmp.audio_frame->nb_samples,
-        in_data,
-        num_samples
-    );
+    s->audio_stream->time_base = c->time_base;
     
-    if (ret < 0) {
-        return RTMP_ERROR_ENCODE_FAILED;
+    // Allocate audio frame
+    s->audio_frame = av_frame_alloc();
+    if (!s->audio_frame) {
+        SET_ERROR(s, "Failed to allocate audio frame");
+        avcodec_free_context(&s->audio_codec_ctx);
+        s->audio_codec_ctx = NULL;
+        return RTMP_ERROR_ALLOC_FAILED;
     }
     
-    // Set PTS
-    g_rtmp.audio_frame->pts = av_rescale_q(
-        pts,
-        (AVRational){1, 1000},
-        g_rtmp.audio_codec_ctx->time_base
-    );
+    s->audio_frame->format = c->sample_fmt;
+    av_channel_layout_copy(&s->audio_frame->ch_layout, &c->ch_layout);
+    s->audio_frame->sample_rate = c->sample_rate;
+    s->audio_frame->nb_samples = c->frame_size;
     
-    // Send frame to encoder
-    ret = avcodec_send_frame(g_rtmp.audio_codec_ctx, g_rtmp.audio_frame);
+    ret = av_frame_get_buffer(s->audio_frame, 0);
     if (ret < 0) {
-        return RTMP_ERROR_ENCODE_FAILED;
+        SET_ERROR(s, "Failed to allocate audio frame buffer: %s", av_err2str(ret));
+        av_frame_free(&s->audio_frame);
+        avcodec_free_context(&s->audio_codec_ctx);
+        s->audio_codec_ctx = NULL;
+        return RTMP_ERROR_ALLOC_FAILED;
     }
     
-    // Receive and write packets
-    while (ret >= 0) {
-        ret = avcodec_receive_packet(g_rtmp.audio_codec_ctx, g_rtmp.packet);
-        if (ret == AVERROR(EAGAIN) || ret == AVERROR_EOF) {
-            break;
-        } else if (ret < 0) {
-            return RTMP_ERROR_ENCODE_FAILED;
-        }
-        
-        av_packet_rescale_ts(g_rtmp.packet, g_rtmp.audio_codec_ctx->time_base, g_rtmp.audio_stream->time_base);
-        g_rtmp.packet->stream_index = g_rtmp.audio_stream->index;
-        
-        ret = av_interleaved_write_frame(g_rtmp.format_ctx, g_rtmp.packet);
-        if (ret < 0) {
-            av_packet_unref(g_rtmp.packet);
-            return RTMP_ERROR_SEND_FAILED;
-        }
-        
-        g_rtmp.bytes_sent += g_rtmp.packet->size;
-        av_packet_unref(g_rtmp.packet);
+    // Create resampler for interleaved float -> planar float
+    s->swr_ctx = swr_alloc();
+    if (!s->swr_ctx) {
+        SET_ERROR(s, "Failed to allocate resampler");
+        av_frame_free(&s->audio_frame);
+        avcodec_free_context(&s->audio_codec_ctx);
+        s->audio_codec_ctx = NULL;
+        return RTMP_ERROR_ALLOC_FAILED;
+    }
+    
+    AVChannelLayout in_layout;
+    av_channel_layout_default(&in_layout, s->config.audio_channels);
+    
+    av_opt_set_chlayout(s->swr_ctx, "in_chlayout", &in_layout, 0);
+    av_opt_set_chlayout(s->swr_ctx, "out_chlayout", &c->ch_layout, 0);
+    av_opt_set_int(s->swr_ctx, "in_sample_rate", s->config.audio_sample_rate, 0);
+    av_opt_set_int(s->swr_ctx, "out_sample_rate", c->sample_rate, 0);
+    av_opt_set_sample_fmt(s->swr_ctx, "in_sample_fmt", AV_SAMPLE_FMT_FLT, 0); // Unity uses float
+    av_opt_set_sample_fmt(s->swr_ctx, "out_sample_fmt", AV_SAMPLE_FMT_FLTP, 0);
+    
+    ret = swr_init(s->swr_ctx);
+    if (ret < 0) {
+        SET_ERROR(s, "Failed to init resampler: %s", av_err2str(ret));
+        swr_free(&s->swr_ctx);
+        av_frame_free(&s->audio_frame);
+        avcodec_free_context(&s->audio_codec_ctx);
+        s->audio_codec_ctx = NULL;
+        return RTMP_ERROR_INIT_FAILED;
     }
     
+    av_channel_layout_uninit(&in_layout);
+    
     return RTMP_SUCCESS;
 }
 
-RTMP_API int rtmp_stop_streaming(void) {
-    MUTEX_LOCK(g_rtmp.mutex);
+static int packet_queue_init(PacketQueue* q, int capacity, int drop_policy, int video_stream_index) {
+    q->packets = av_calloc(capacity, sizeof(AVPacket*));
+    if (!q->packets) {
+        return RTMP_ERROR_ALLOC_FAILED;
+    }
     
-    if (g_rtmp.state == RTMP_STATE_STREAMING) {
-        g_rtmp.state = RTMP_STATE_CONNECTED;
+    for (int i = 0; i < capacity; i++) {
+        q->packets[i] = av_packet_alloc();
+        if (!q->packets[i]) {
+            for (int j = 0; j < i; j++) {
+                av_packet_free(&q->packets[j]);
+            }
+            av_freep(&q->packets);
+            return RTMP_ERROR_ALLOC_FAILED;
+        }
     }
     
-    MUTEX_UNLOCK(g_rtmp.mutex);
+    q->capacity = capacity;
+    q->head = 0;
+    ATOMIC_STORE(&q->count, 0);
+    ATOMIC_STORE(&q->high_water, 0);
+    q->drop_policy = drop_policy;
+    q->video_stream_index = video_stream_index;
+    q->waiting_for_keyframe = 0;
+    ATOMIC_STORE(&q->dropped_packets, 0);
+    ATOMIC_STORE(&q->dropped_video, 0);
+    q->finished = 0;
+    MUTEX_INIT(q->mutex);
+    COND_INIT(q->cond);
     return RTMP_SUCCESS;
 }
 
-RTMP_API int rtmp_disconnect(void) {
-    MUTEX_LOCK(g_rtmp.mutex);
+static void packet_queue_destroy(PacketQueue* q) {
+    if (!q->packets) {
+        return;
+    }
     
-    if (g_rtmp.format_ctx) {
-        // Flush encoders
-        if (g_rtmp.video_codec_ctx) {
-            avcodec_send_frame(g_rtmp.video_codec_ctx, NULL);
-            while (avcodec_receive_packet(g_rtmp.video_codec_ctx, g_rtmp.packet) >= 0) {
-                av_packet_rescale_ts(g_rtmp.packet, g_rtmp.video_codec_ctx->time_base, g_rtmp.video_stream->time_base);
-                g_rtmp.packet->stream_index = g_rtmp.video_stream->index;
-                av_interleaved_write_frame(g_rtmp.format_ctx, g_rtmp.packet);
-                av_packet_unref(g_rtmp.packet);
+    for (int i = 0; i < q->capacity; i++) {
+        av_packet_free(&q->packets[i]);
+    }
+    av_freep(&q->packets);
+    q->capacity = 0;
+    ATOMIC_STORE(&q->count, 0);
+    MUTEX_DESTROY(q->mutex);
+    COND_DESTROY(q->cond);
+}
+
+// Called with q->mutex held
+static void packet_queue_drop(PacketQueue* q, AVPacket* pkt) {
+    if (pkt->stream_index == q->video_stream_index) {
+        ATOMIC_ADD(&q->dropped_video, 1);
+        q->waiting_for_keyframe = 1;
+    }
+    ATOMIC_ADD(&q->dropped_packets, 1);
+    av_packet_unref(pkt);
+}
+
+// Called with q->mutex held. Discards every queued video packet, audio stays.
+static void packet_queue_flush_video(PacketQueue* q) {
+    int kept = 0;
+    int count = q->count;
+    
+    for (int i = 0; i < count; i++) {
+        AVPacket* p = q->packets[(q->head + i) % q->capacity];
+        if (p->stream_index == q->video_stream_index) {
+            packet_queue_drop(q, p);
+        } else {
+            // Audio already in place stays put; moving onto itself would blank it
+            if (kept != i) {
+                av_packet_move_ref(q->packets[(q->head + kept) % q->capacity], p);
             }
-        }
-        
-        // Write trailer
-        av_write_trailer(g_rtmp.format_ctx);
-        
-        // Close connection
-        if (!(g_rtmp.format_ctx->oformat->flags & AVFMT_NOFILE)) {
-            avio_closep(&g_rtmp.format_ctx->pb);
+            kept++;
         }
     }
+    ATOMIC_STORE(&q->count, kept);
+}
+
+// Moves pkt into the queue, or drops it. pkt is always left blank.
+static int packet_queue_push(PacketQueue* q, AVPacket* pkt) {
+    int is_video = pkt->stream_index == q->video_stream_index;
+    int is_key = (pkt->flags & AV_PKT_FLAG_KEY) != 0;
     
-    // Clean up resources
-    if (g_rtmp.sws_ctx) {
-        sws_freeContext(g_rtmp.sws_ctx);
-        g_rtmp.sws_ctx = NULL;
+    MUTEX_LOCK(q->mutex);
+    
+    if (q->count == q->capacity && is_video && q->drop_policy == RTMP_DROP_QUEUED) {
+        packet_queue_flush_video(q);
     }
     
-    if (g_rtmp.swr_ctx) {
-        swr_free(&g_rtmp.swr_ctx);
+    if (is_video && q->waiting_for_keyframe && !is_key) {
+        packet_queue_drop(q, pkt);
+        MUTEX_UNLOCK(q->mutex);
+        return 0;
     }
     
-    if (g_rtmp.video_frame) {
-        av_frame_free(&g_rtmp.video_frame);
+    if (q->count == q->capacity) {
+        packet_queue_drop(q, pkt);
+        MUTEX_UNLOCK(q->mutex);
+        return 0;
     }
     
-    if (g_rtmp.audio_frame) {
-        av_frame_free(&g_rtmp.audio_frame);
+    if (is_video) {
+        q->waiting_for_keyframe = 0;
     }
     
-    if (g_rtmp.video_codec_ctx) {
-        avcodec_free_context(&g_rtmp.video_codec_ctx);
+    av_packet_move_ref(q->packets[(q->head + q->count) % q->capacity], pkt);
+    ATOMIC_ADD(&q->count, 1);
+    if (q->count > q->high_water) {
+        ATOMIC_STORE(&q->high_water, q->count);
     }
+    COND_SIGNAL(q->cond);
     
-    if (g_rtmp.audio_codec_ctx) {
-        avcodec_free_context(&g_rtmp.audio_codec_ctx);
+    MUTEX_UNLOCK(q->mutex);
+    return 1;
+}
+
+// Blocks until a packet is available. Returns 0 once finished and drained.
+static int packet_queue_pop(PacketQueue* q, AVPacket* out) {
+    MUTEX_LOCK(q->mutex);
+    
+    while (q->count == 0 && !q->finished) {
+        COND_WAIT(q->cond, q->mutex);
     }
     
-    if (g_rtmp.format_ctx) {
-        avformat_free_context(g_rtmp.format_ctx);
-        g_rtmp.format_ctx = NULL;
+    if (q->count == 0) {
+        MUTEX_UNLOCK(q->mutex);
+        return 0;
     }
     
-    g_rtmp.video_stream = NULL;
-    g_rtmp.audio_stream = NULL;
-    g_rtmp.state = RTMP_STATE_INITIALIZED;
+    av_packet_move_ref(out, q->packets[q->head]);
+    q->head = (q->head + 1) % q->capacity;
+    ATOMIC_ADD(&q->count, -1);
     
-    MUTEX_UNLOCK(g_rtmp.mutex);
-    return RTMP_SUCCESS;
+    MUTEX_UNLOCK(q->mutex);
+    return 1;
 }
 
-RTMP_API void rtmp_cleanup(void) {
-    rtmp_disconnect();
+static void packet_queue_finish(PacketQueue* q) {
+    MUTEX_LOCK(q->mutex);
+    q->finished = 1;
+    COND_BROADCAST(q->cond);
+    MUTEX_UNLOCK(q->mutex);
+}
+
+// Starts a fresh measurement window, e.g. so an outage isn't read as congestion
+static void abr_restart_window(RTMPSession* s) {
+    AbrController* abr = &s->abr;
+    abr->window_start = av_gettime_relative();
+    abr->write_us = 0;
+    abr->max_depth = 0;
+    abr->last_dropped = ATOMIC_LOAD(&s->send_queue.dropped_video);
+    abr->clear_windows = 0;
+}
+
+static void abr_reset(RTMPSession* s) {
+    AbrController* abr = &s->abr;
+    abr->enabled = s->config.adaptive_bitrate && s->encoder_runtime_bitrate;
+    if (s->config.adaptive_bitrate && !abr->enabled) {
+        // Its bitrate changes would never reach the stream
+        fprintf(stderr, "[RTMP] Warning: %s cannot change bitrate while streaming, adaptive bitrate disabled\n", s->video_encoder);
+    }
+    abr->min_kbps = s->config.min_bitrate_kbps;
+    abr->current_kbps = s->config.bitrate_kbps;
+    abr_restart_window(s);
+}
+
+// Called by the sender thread after every write
+static void abr_update(RTMPSession* s, int64_t write_us) {
+    AbrController* abr = &s->abr;
+    if (!abr->enabled) {
+        return;
+    }
+    
+    abr->write_us += write_us;
+    abr->max_depth = FFMAX(abr->max_depth, ATOMIC_LOAD(&s->send_queue.count));
+    
+    int64_t now = av_gettime_relative();
+    int64_t elapsed = now - abr->window_start;
+    if (elapsed < RTMP_ABR_WINDOW_US) {
+        return;
+    }
     
-    MUTEX_LOCK(g_rtmp.mutex);
+    int capacity = s->send_queue.capacity;
+    int dropped = ATOMIC_LOAD(&s->send_queue.dropped_video);
+    int busy_pct = (int)(abr->write_us * 100 / elapsed);
+    int max_kbps = ATOMIC_LOAD(&abr->max_kbps);
+    int target = abr->current_kbps;
     
-    if (g_rtmp.packet) {
-        av_packet_free(&g_rtmp.packet);
+    if (dropped != abr->last_dropped || abr->max_depth * 2 > capacity || busy_pct > RTMP_ABR_BUSY_HIGH_PCT) {
+        // Falling behind: back off hard so the queue drains before it overflows
+        target = FFMAX(abr->current_kbps * RTMP_ABR_DECREASE_PCT / 100, abr->min_kbps);
+        abr->clear_windows = 0;
+    } else if (abr->max_depth * 10 <= capacity && busy_pct < RTMP_ABR_BUSY_LOW_PCT) {
+        if (++abr->clear_windows >= RTMP_ABR_CLEAR_WINDOWS) {
+            target = abr->current_kbps + FFMAX(max_kbps * RTMP_ABR_INCREASE_PCT / 100, 1);
+            abr->clear_windows = 0;
+        }
+    } else {
+        abr->clear_windows = 0;
     }
     
-    g_rtmp.state = RTMP_STATE_IDLE;
+    target = FFMIN(target, max_kbps);
+    if (target != abr->current_kbps) {
+        abr->current_kbps = target;
+        ATOMIC_STORE(&s->pending_bitrate_kbps, target);
+    }
     
-    MUTEX_UNLOCK(g_rtmp.mutex);
+    abr->window_start = now;
+    abr->write_us = 0;
+    abr->max_depth = 0;
+    abr->last_dropped = dropped;
 }
 
-RTMP_API int rtmp_get_state(void) {
-    return g_rtmp.state;
+// Ends whichever muxer is writing to the network. format_ctx itself stays,
+// the encoders still use its streams.
+static void close_link(RTMPSession* s, int write_trailer) {
+    AVFormatContext* link = s->link_ctx ? s->link_ctx : s->format_ctx;
+    if (link->pb) {
+        if (write_trailer) {
+            av_write_trailer(link);
+        }
+        avio_closep(&link->pb);
+    }
+    if (s->link_ctx) {
+        avformat_free_context(s->link_ctx);
+        s->link_ctx = NULL;
+    }
 }
 
-RTMP_API const char* rtmp_get_error(void) {
-    return g_rtmp.error_msg;
+// Aborts a reconnect blocked in the network once disconnect is called
+static int sender_interrupted(void* opaque) {
+    RTMPSession* s = (RTMPSession*)opaque;
+    return ATOMIC_LOAD(&s->sender_stop);
 }
 
-RTMP_API int64_t rtmp_get_bytes_sent(void) {
-    return g_rtmp.bytes_sent;
+// Opens a new FLV muxer to the same URL with the same streams
+static int open_link(RTMPSession* s) {
+    AVFormatContext* link = NULL;
+    int ret = avformat_alloc_output_context2(&link, NULL, "flv", s->format_ctx->url);
+    if (ret < 0 || !link) {
+        SET_SENDER_ERROR(s, "Reconnect: failed to create output context: %s", av_err2str(ret));
+        return RTMP_ERROR_INIT_FAILED;
+    }
+    link->interrupt_callback.callback = sender_interrupted;
+    link->interrupt_callback.opaque = s;
+    
+    for (unsigned i = 0; i < s->format_ctx->nb_streams; i++) {
+        AVStream* st = avformat_new_stream(link, NULL);
+        if (!st || avcodec_parameters_copy(st->codecpar, s->format_ctx->streams[i]->codecpar) < 0) {
+            SET_SENDER_ERROR(s, "Reconnect: failed to create stream");
+            avformat_free_context(link);
+            return RTMP_ERROR_INIT_FAILED;
+        }
+        st->time_base = s->format_ctx->streams[i]->time_base;
+    }
+    
+    ret = avio_open2(&link->pb, s->format_ctx->url, AVIO_FLAG_WRITE, &link->interrupt_callback, NULL);
+    if (ret < 0) {
+        SET_SENDER_ERROR(s, "Reconnect: failed to open connection: %s", av_err2str(ret));
+        avformat_free_context(link);
+        return RTMP_ERROR_CONNECT_FAILED;
+    }
+    
+    AVDictionary* opts = NULL;
+    av_dict_set(&opts, "flvflags", "no_duration_filesize", 0);
+    ret = avformat_write_header(link, &opts);
+    av_dict_free(&opts);
+    if (ret < 0) {
+        SET_SENDER_ERROR(s, "Reconnect: failed to write header: %s", av_err2str(ret));
+        avio_closep(&link->pb);
+        avformat_free_context(link);
+        return RTMP_ERROR_CONNECT_FAILED;
+    }
+    
+    s->link_ctx = link;
+    return RTMP_SUCCESS;
 }
 
-RTMP_API int rtmp_get_frames_sent(void) {
-    return g_rtmp.frames_sent;
-}
+// Sleeps in short steps so disconnect never waits out a long backoff.
+// Returns 0 if the sender is being stopped.
+static int reconnect_wait(RTMPSession* s, int delay_ms) {
+    for (int waited = 0; waited < delay_ms; waited += RTMP_RECONNECT_POLL_MS) {
+        if (ATOMIC_LOAD(&s->sender_stop)) {
+            return 0;
+        }
+        av_usleep(RTMP_RECONNECT_POLL_MS * 1000);
+    }
+    return !ATOMIC_LOAD(&s->sender_stop);
+}
+
+// Runs on the sender thread after a failed write. The encoders keep filling
+// send_queue meanwhile, which drops on overflow like any other backlog.
+static int reconnect_link(RTMPSession* s) {
+    ATOMIC_STORE(&s->reconnecting, 1);
+    close_link(s, 0);
+    
+    int ret = RTMP_ERROR_CONNECT_FAILED;
+    int delay_ms = RTMP_RECONNECT_MIN_DELAY_MS;
+    for (int attempt = 0; attempt < s->config.reconnect_attempts; attempt++) {
+        if (!reconnect_wait(s, delay_ms)) {
+            break;
+        }
+        
+        ret = open_link(s);
+        if (ret == RTMP_SUCCESS) {
+            fprintf(stderr, "[RTMP] Reconnected after %d attempt(s)\n", attempt + 1);
+            ATOMIC_ADD(&s->reconnects, 1);
+            break;
+        }
+        delay_ms = FFMIN(delay_ms * 2, RTMP_RECONNECT_MAX_DELAY_MS);
+        fprintf(stderr, "[RTMP] %s, retrying in %dms\n", s->sender_error, delay_ms);
+    }
+    
+    ATOMIC_STORE(&s->reconnecting, 0);
+    return ret;
+}
+
+static THREAD_PROC(sender_thread_main) {
+    RTMPSession* s = (RTMPSession*)arg;
+    AVPacket* pkt = s->sender_packet;
+    int link_down = 0;
+    int resume_at_keyframe = 0;
+    
+    while (packet_queue_pop(&s->send_queue, pkt)) {
+        int is_video = pkt->stream_index == s->send_queue.video_stream_index;
+        int size = pkt->size;
+        
+        // After a reconnect, the video backlog up to the next keyframe can't
+        // be decoded by the new connection. Audio goes out straight away.
+        if (link_down || (resume_at_keyframe && is_video && !(pkt->flags & AV_PKT_FLAG_KEY))) {
+            if (is_video) {
+                ATOMIC_ADD(&s->send_queue.dropped_video, 1);
+            }
+            av_packet_unref(pkt);
+            continue;
+        }
+        if (is_video) {
+            resume_at_keyframe = 0;
+        }
+        
+        AVFormatContext* link = s->format_ctx;
+        if (s->link_ctx) {
+            link = s->link_ctx;
+            av_packet_rescale_ts(pkt, s->format_ctx->streams[pkt->stream_index]->time_base, link->streams[pkt->stream_index]->time_base);
+        }
+        
+        // The sender thread is the only writer while it runs
+        int64_t write_start = av_gettime_relative();
+        int ret = av_interleaved_write_frame(link, pkt);
+        abr_update(s, av_gettime_relative() - write_start);
+        if (ret < 0) {
+            SET_SENDER_ERROR(s, "Failed to write %s packet: %s", is_video ? "video" : "audio", av_err2str(ret));
+            av_packet_unref(pkt);
+            if (is_video) {
+                ATOMIC_ADD(&s->send_queue.dropped_video, 1);
+            }
+            
+            if (s->config.reconnect_attempts > 0 && !ATOMIC_LOAD(&s->sender_stop)) {
+                fprintf(stderr, "[RTMP] %s, reconnecting\n", s->sender_error);
+                if (reconnect_link(s) == RTMP_SUCCESS) {
+                    resume_at_keyframe = 1;
+                    ATOMIC_STORE(&s->keyframe_requested, 1);
+                    abr_restart_window(s);
+                    continue;
+                }
+                // Out of attempts: stop writing, the caller sees the error
+                link_down = 1;
+            }
+            set_async_error(s, RTMP_ERROR_SEND_FAILED);
+            continue;
+        }
+        
+        ATOMIC_ADD64(&s->bytes_sent, size);
+    }
+    
+    THREAD_RETURN;
+}
+
+// Called with s->mutex held, after the stream header is written
+static int start_sender_thread(RTMPSession* s) {
+    int ret = packet_queue_init(
+        &s->send_queue,
+        s->config.send_queue_size,
+        s->config.drop_policy,
+        s->video_stream->index
+    );
+    if (ret != RTMP_SUCCESS) {
+        SET_ERROR(s, "Failed to allocate send queue");
+        return ret;
+    }
+    
+    abr_reset(s);
+    s->sender_error[0] = '\0';
+    ATOMIC_STORE(&s->sender_stop, 0);
+    ATOMIC_STORE(&s->reconnecting, 0);
+    ATOMIC_STORE(&s->reconnects, 0);
+    
+    if (THREAD_CREATE(s->sender_thread, sender_thread_main, s) != 0) {
+        SET_ERROR(s, "Failed to start sender thread");
+        packet_queue_destroy(&s->send_queue);
+        return RTMP_ERROR_INIT_FAILED;
+    }
+    
+    s->sender_running = 1;
+    return RTMP_SUCCESS;
+}
+
+// Queued packets are written before the thread exits
+static void stop_sender_thread(RTMPSession* s) {
+    if (!s->sender_running) {
+        return;
+    }
+    
+    ATOMIC_STORE(&s->sender_stop, 1);
+    packet_queue_finish(&s->send_queue);
+    THREAD_JOIN(s->sender_thread);
+    s->sender_running = 0;
+}
+
+// Encoders call this for every packet, one at a time. Destinations get a
+// reference, the main queue takes the packet itself; pkt is left blank.
+static void send_packet(RTMPSession* s, AVPacket* pkt) {
+    for (int i = 0; i < s->destination_count; i++) {
+        Output* o = &s->destinations[i];
+        if (ATOMIC_LOAD(&o->state) != RTMP_STATE_CONNECTED) {
+            continue;
+        }
+        if (av_packet_ref(s->fanout_packet, pkt) == 0) {
+            packet_queue_push(&o->queue, s->fanout_packet);
+        }
+    }
+    
+    if (s->replay.capacity > 0) {
+        replay_push(s, pkt);
+    }
+    
+    if (ATOMIC_LOAD(&s->recording.state) == RTMP_STATE_CONNECTED) {
+        MUTEX_LOCK(s->recording_mutex);
+        if (ATOMIC_LOAD(&s->recording.state) == RTMP_STATE_CONNECTED && av_packet_ref(s->fanout_packet, pkt) == 0) {
+            packet_queue_push(&s->recording.queue, s->fanout_packet);
+        }
+        MUTEX_UNLOCK(s->recording_mutex);
+    }
+    
+    packet_queue_push(&s->send_queue, pkt);
+}
+
+// Interrupt callback of every output, so neither a stalled network nor a
+// hung connect can hold up close
+static int output_interrupted(void* opaque) {
+    Output* o = (Output*)opaque;
+    int64_t deadline = ATOMIC_LOAD64(&o->close_deadline);
+    return ATOMIC_LOAD(&o->abort) || (deadline && av_gettime_relative() > deadline);
+}
+
+static THREAD_PROC(output_thread_main) {
+    Output* o = (Output*)arg;
+    AVPacket* pkt = o->packet;
+    
+    while (packet_queue_pop(&o->queue, pkt)) {
+        if (ATOMIC_LOAD(&o->state) != RTMP_STATE_CONNECTED) {
+            // Failed: drain so the encoders never see a full queue
+            av_packet_unref(pkt);
+            continue;
+        }
+        
+        int size = pkt->size;
+        AVStream* st = o->format_ctx->streams[pkt->stream_index];
+        av_packet_rescale_ts(pkt, o->time_base[pkt->stream_index], st->time_base);
+        
+        int ret = av_interleaved_write_frame(o->format_ctx, pkt);
+        if (ret < 0) {
+            fprintf(stderr, "[RTMP] Destination %s failed: %s\n", o->url, av_err2str(ret));
+            av_packet_unref(pkt);
+            ATOMIC_STORE(&o->state, RTMP_STATE_ERROR);
+            continue;
+        }
+        
+        ATOMIC_ADD64(&o->bytes_sent, size);
+    }
+    
+    THREAD_RETURN;
+}
+
+// Called once the main stream's encoders are open, with s->mutex held or
+// from connect_session. Mirrors the main stream's codec parameters into a
+// new muxer for o->url, over pb if it is already connected.
+static int open_output(RTMPSession* s, Output* o, const char* format, AVDictionary** opts, AVIOContext* pb) {
+    AVStream* sources[2] = { s->video_stream, s->audio_stream };
+    
+    ATOMIC_STORE64(&o->bytes_sent, 0);
+    ATOMIC_STORE64(&o->close_deadline, 0);
+    
+    int ret = avformat_alloc_output_context2(&o->format_ctx, NULL, format, o->url);
+    if (ret < 0 || !o->format_ctx) {
+        SET_ERROR(s, "Failed to create output context for %s: %s", o->url, av_err2str(ret));
+        ATOMIC_STORE(&o->state, RTMP_STATE_ERROR);
+        if (pb) {
+            avio_closep(&pb);
+        }
+        return RTMP_ERROR_INIT_FAILED;
+    }
+    o->interrupt.callback = output_interrupted;
+    o->interrupt.opaque = o;
+    o->format_ctx->interrupt_callback = o->interrupt;
+    o->format_ctx->pb = pb;
+    
+    for (int i = 0; i < 2 && sources[i]; i++) {
+        AVStream* st = avformat_new_stream(o->format_ctx, NULL);
+        if (!st || avcodec_parameters_copy(st->codecpar, sources[i]->codecpar) < 0) {
+            SET_ERROR(s, "Failed to create output stream for %s", o->url);
+            ret = RTMP_ERROR_INIT_FAILED;
+            goto fail;
+        }
+        // The main muxer's tag may not exist in this container
+        st->codecpar->codec_tag = 0;
+        st->time_base = sources[i]->time_base;
+        o->time_base[i] = sources[i]->time_base;
+    }
+    
+    if (!o->format_ctx->pb && !(o->format_ctx->oformat->flags & AVFMT_NOFILE)) {
+        ret = avio_open2(&o->format_ctx->pb, o->url, AVIO_FLAG_WRITE, &o->interrupt, NULL);
+        if (ret < 0) {
+            SET_ERROR(s, "Failed to open %s: %s", o->url, av_err2str(ret));
+            ret = RTMP_ERROR_CONNECT_FAILED;
+            goto fail;
+        }
+    }
+    
+    ret = avformat_write_header(o->format_ctx, opts);
+    if (ret < 0) {
+        SET_ERROR(s, "Failed to write header to %s: %s", o->url, av_err2str(ret));
+        ret = RTMP_ERROR_CONNECT_FAILED;
+        goto fail;
+    }
+    
+    o->packet = av_packet_alloc();
+    ret = packet_queue_init(&o->queue, s->config.send_queue_size, s->config.drop_policy, s->video_stream->index);
+    if (!o->packet || ret != RTMP_SUCCESS) {
+        SET_ERROR(s, "Failed to allocate queue for %s", o->url);
+        packet_queue_destroy(&o->queue);
+        ret = RTMP_ERROR_ALLOC_FAILED;
+        goto fail;
+    }
+    // Anything joining after the first packet starts cleanly on a keyframe
+    o->queue.waiting_for_keyframe = 1;
+    
+    ATOMIC_STORE(&o->state, RTMP_STATE_CONNECTED);
+    if (THREAD_CREATE(o->thread, output_thread_main, o) != 0) {
+        SET_ERROR(s, "Failed to start writer thread for %s", o->url);
+        packet_queue_destroy(&o->queue);
+        ret = RTMP_ERROR_INIT_FAILED;
+        goto fail;
+    }
+    o->running = 1;
+    return RTMP_SUCCESS;
+    
+fail:
+    ATOMIC_STORE(&o->state, RTMP_STATE_ERROR);
+    av_packet_free(&o->packet);
+    if (o->format_ctx->pb) {
+        avio_closep(&o->format_ctx->pb);
+    }
+    avformat_free_context(o->format_ctx);
+    o->format_ctx = NULL;
+    return ret;
+}
+
+// Writes out what is queued, then the trailer, giving up on an output that
+// is still blocked after RTMP_OUTPUT_CLOSE_TIMEOUT_US
+static void close_output(Output* o) {
+    if (o->running) {
+        ATOMIC_STORE64(&o->close_deadline, av_gettime_relative() + RTMP_OUTPUT_CLOSE_TIMEOUT_US);
+        packet_queue_finish(&o->queue);
+        THREAD_JOIN(o->thread);
+        o->running = 0;
+        
+        av_write_trailer(o->format_ctx);
+        if (!(o->format_ctx->oformat->flags & AVFMT_NOFILE)) {
+            avio_closep(&o->format_ctx->pb);
+        }
+        avformat_free_context(o->format_ctx);
+        o->format_ctx = NULL;
+        packet_queue_destroy(&o->queue);
+        av_packet_free(&o->packet);
+    }
+}
+
+// Starts each destination's handshake on its own thread. They run
+// alongside the main connection and the encoders, outside s->mutex.
+static void start_destination_opens(RTMPSession* s) {
+    for (int i = 0; i < s->destination_count; i++) {
+        Output* o = &s->destinations[i];
+        o->interrupt.callback = output_interrupted;
+        o->interrupt.opaque = o;
+        o->net = (NetworkOpen){ o->url, &o->interrupt, NULL, 0 };
+        o->net_started = THREAD_CREATE(o->net_thread, network_open_main, &o->net) == 0;
+    }
+}
+
+// Waits for the handshakes, running any that got no thread here
+static void join_destination_opens(RTMPSession* s) {
+    for (int i = 0; i < s->destination_count; i++) {
+        Output* o = &s->destinations[i];
+        if (o->net_started) {
+            THREAD_JOIN(o->net_thread);
+            o->net_started = 0;
+        } else {
+            network_open_main(&o->net);
+        }
+    }
+}
+
+// Writes each connected destination's header and starts its writer thread
+static void open_destinations(RTMPSession* s) {
+    for (int i = 0; i < s->destination_count; i++) {
+        Output* o = &s->destinations[i];
+        AVIOContext* pb = o->net.pb;
+        o->net.pb = NULL;
+        if (o->net.ret < 0) {
+            fprintf(stderr, "[RTMP] Warning: Failed to open %s: %s, streaming without it\n", o->url, av_err2str(o->net.ret));
+            ATOMIC_STORE(&o->state, RTMP_STATE_ERROR);
+            continue;
+        }
+        
+        AVDictionary* opts = NULL;
+        av_dict_set(&opts, "flvflags", "no_duration_filesize", 0);
+        if (open_output(s, o, "flv", &opts, pb) != RTMP_SUCCESS) {
+            fprintf(stderr, "[RTMP] Warning: %s, streaming without it\n", s->error_msg);
+        }
+        av_dict_free(&opts);
+    }
+    if (s->destination_count > 0) {
+        // Errors above are per destination, not the connect's
+        s->error_msg[0] = '\0';
+    }
+}
+
+static void close_destinations(RTMPSession* s) {
+    for (int i = 0; i < s->destination_count; i++) {
+        // A handshake that finished but was never used
+        if (s->destinations[i].net.pb) {
+            avio_closep(&s->destinations[i].net.pb);
+        }
+        close_output(&s->destinations[i]);
+        ATOMIC_STORE(&s->destinations[i].state, RTMP_STATE_INITIALIZED);
+    }
+}
+
+// Finishes the file: queued packets, then the trailer
+static void stop_recording(RTMPSession* s) {
+    MUTEX_LOCK(s->recording_mutex);
+    ATOMIC_STORE(&s->recording.state, RTMP_STATE_IDLE);
+    MUTEX_UNLOCK(s->recording_mutex);
+    
+    close_output(&s->recording);
+    av_freep(&s->recording.url);
+}
+
+// Called with s->mutex held, once the encoders are open. Sized for the
+// window plus the GOP it starts in, at the frame and AAC packet rates.
+static int replay_init(RTMPSession* s) {
+    ReplayBuffer* r = &s->replay;
+    AVStream* sources[2] = { s->video_stream, s->audio_stream };
+    
+    MUTEX_LOCK(s->replay_mutex);
+    replay_free(s);
+    
+    if (s->config.replay_buffer_seconds <= 0) {
+        MUTEX_UNLOCK(s->replay_mutex);
+        return RTMP_SUCCESS;
+    }
+    
+    int seconds = s->config.replay_buffer_seconds + s->config.keyframe_interval + 1;
+    int per_second = s->config.fps + (s->audio_stream ? s->config.audio_sample_rate / 1024 + 1 : 0);
+    int capacity = seconds * per_second;
+    
+    r->packets = av_calloc(capacity, sizeof(AVPacket*));
+    r->keyframes = av_calloc(capacity, sizeof(int64_t));
+    int ok = r->packets && r->keyframes;
+    for (int i = 0; ok && i < capacity; i++) {
+        r->packets[i] = av_packet_alloc();
+        ok = r->packets[i] != NULL;
+    }
+    
+    r->nb_streams = 0;
+    for (int i = 0; ok && i < 2 && sources[i]; i++) {
+        r->codecpar[i] = avcodec_parameters_alloc();
+        ok = r->codecpar[i] && avcodec_parameters_copy(r->codecpar[i], sources[i]->codecpar) >= 0;
+        r->time_base[i] = sources[i]->time_base;
+        r->nb_streams++;
+    }
+    
+    // Set last so a half-built buffer is freed in full
+    r->capacity = capacity;
+    if (!ok) {
+        replay_free(s);
+        MUTEX_UNLOCK(s->replay_mutex);
+        return RTMP_ERROR_ALLOC_FAILED;
+    }
+    
+    r->head = 0;
+    r->count = 0;
+    r->first_seq = 0;
+    r->key_head = 0;
+    r->key_count = 0;
+    r->window_us = (int64_t)s->config.replay_buffer_seconds * AV_TIME_BASE;
+    r->video_stream_index = s->video_stream->index;
+    
+    MUTEX_UNLOCK(s->replay_mutex);
+    return RTMP_SUCCESS;
+}
+
+// Called with s->replay_mutex held
+static void replay_free(RTMPSession* s) {
+    ReplayBuffer* r = &s->replay;
+    if (r->packets) {
+        for (int i = 0; i < r->capacity; i++) {
+            av_packet_free(&r->packets[i]);
+        }
+    }
+    av_freep(&r->packets);
+    av_freep(&r->keyframes);
+    for (int i = 0; i < 2; i++) {
+        avcodec_parameters_free(&r->codecpar[i]);
+    }
+    r->capacity = 0;
+    r->count = 0;
+    r->key_count = 0;
+    r->nb_streams = 0;
+}
+
+static int64_t replay_time_us(const ReplayBuffer* r, const AVPacket* pkt) {
+    int64_t ts = pkt->dts != AV_NOPTS_VALUE ? pkt->dts : pkt->pts;
+    return av_rescale_q(ts, r->time_base[pkt->stream_index], (AVRational){1, AV_TIME_BASE});
+}
+
+static AVPacket* replay_packet(const ReplayBuffer* r, int64_t seq) {
+    return r->packets[(r->head + (int)(seq - r->first_seq)) % r->capacity];
+}
+
+// Called with s->replay_mutex held
+static void replay_evict_oldest(ReplayBuffer* r) {
+    if (r->key_count > 0 && r->keyframes[r->key_head] == r->first_seq) {
+        r->key_head = (r->key_head + 1) % r->capacity;
+        r->key_count--;
+    }
+    av_packet_unref(r->packets[r->head]);
+    r->head = (r->head + 1) % r->capacity;
+    r->count--;
+    r->first_seq++;
+}
+
+// Called by send_packet for every packet; takes a reference, no copy
+static void replay_push(RTMPSession* s, const AVPacket* pkt) {
+    ReplayBuffer* r = &s->replay;
+    
+    MUTEX_LOCK(s->replay_mutex);
+    
+    if (r->count == r->capacity) {
+        replay_evict_oldest(r);
+    }
+    
+    AVPacket* slot = r->packets[(r->head + r->count) % r->capacity];
+    if (av_packet_ref(slot, pkt) < 0) {
+        MUTEX_UNLOCK(s->replay_mutex);
+        return;
+    }
+    
+    if (pkt->stream_index == r->video_stream_index && (pkt->flags & AV_PKT_FLAG_KEY)) {
+        r->keyframes[(r->key_head + r->key_count) % r->capacity] = r->first_seq + r->count;
+        r->key_count++;
+    }
+    r->count++;
+    
+    // Drop the oldest GOP once the next keyframe alone covers the window
+    int64_t newest = replay_time_us(r, slot);
+    while (r->key_count >= 2) {
+        int64_t next_key = r->keyframes[(r->key_head + 1) % r->capacity];
+        if (newest - replay_time_us(r, replay_packet(r, next_key)) < r->window_us) {
+            break;
+        }
+        while (r->first_seq < next_key) {
+            replay_evict_oldest(r);
+        }
+    }
+    
+    MUTEX_UNLOCK(s->replay_mutex);
+}
+
+// Takes references to everything from the last keyframe at least `seconds`
+// before the newest packet (or the oldest keyframe) onwards
+static int replay_snapshot(RTMPSession* s, int seconds, AVPacket*** out, int* out_count) {
+    ReplayBuffer* r = &s->replay;
+    
+    MUTEX_LOCK(s->replay_mutex);
+    
+    if (r->key_count == 0) {
+        SET_ERROR(s, "No keyframe in the replay buffer yet");
+        MUTEX_UNLOCK(s->replay_mutex);
+        return RTMP_ERROR_NOT_CONNECTED;
+    }
+    
+    int64_t newest = replay_time_us(r, replay_packet(r, r->first_seq + r->count - 1));
+    int64_t target = newest - (int64_t)seconds * AV_TIME_BASE;
+    int64_t start = r->keyframes[r->key_head];
+    for (int i = 1; i < r->key_count; i++) {
+        int64_t key = r->keyframes[(r->key_head + i) % r->capacity];
+        if (replay_time_us(r, replay_packet(r, key)) > target) {
+            break;
+        }
+        start = key;
+    }
+    
+    int count = (int)(r->first_seq + r->count - start);
+    AVPacket** packets = av_calloc(count, sizeof(AVPacket*));
+    int taken = 0;
+    for (; packets && taken < count; taken++) {
+        packets[taken] = av_packet_clone(replay_packet(r, start + taken));
+        if (!packets[taken]) {
+            break;
+        }
+    }
+    
+    MUTEX_UNLOCK(s->replay_mutex);
+    
+    if (!packets || taken < count) {
+        for (int i = 0; packets && i < taken; i++) {
+            av_packet_free(&packets[i]);
+        }
+        av_free(packets);
+        SET_ERROR(s, "Failed to allocate replay packets");
+        return RTMP_ERROR_ALLOC_FAILED;
+    }
+    
+    *out = packets;
+    *out_count = count;
+    return RTMP_SUCCESS;
+}
+
+static void set_async_error(RTMPSession* s, int error) {
+    ATOMIC_STORE(&s->async_error, error);
+}
+
+// Returns and clears the last error raised on the encoder or sender thread
+static int take_async_error(RTMPSession* s) {
+    int ret = ATOMIC_EXCHANGE(&s->async_error, RTMP_SUCCESS);
+    if (ret == RTMP_ERROR_SEND_FAILED) {
+        MUTEX_LOCK(s->sender_error_mutex);
+        if (s->sender_error[0]) {
+            SET_ERROR(s, "%s", s->sender_error);
+            s->sender_error[0] = '\0';
+        }
+        MUTEX_UNLOCK(s->sender_error_mutex);
+    }
+    return ret;
+}
+
+RTMP_API int rtmp_session_start_streaming(RTMPSession* s) {
+    if (s == NULL || !s->mutex_initialized) {
+        return RTMP_ERROR_INVALID_PARAMS;
+    }
+    
+    MUTEX_LOCK(s->mutex);
+    
+    if (s->state != RTMP_STATE_CONNECTED) {
+        SET_ERROR(s, "Not connected. Call rtmp_connect first.");
+        MUTEX_UNLOCK(s->mutex);
+        return RTMP_ERROR_NOT_CONNECTED;
+    }
+    
+    if (s->config.async_encode && !s->encoder_running) {
+        int ret = start_encoder_thread(s);
+        if (ret != RTMP_SUCCESS) {
+            MUTEX_UNLOCK(s->mutex);
+            return ret;
+        }
+    }
+    
+    s->state = RTMP_STATE_STREAMING;
+    s->start_time = av_gettime_relative();
+    if (s->encoder_running) {
+        ATOMIC_STORE(&s->rings_open, 1);
+    }
+    
+    MUTEX_UNLOCK(s->mutex);
+    
+    for (int i = 0; i < s->rendition_count; i++) {
+        int ret = rtmp_session_start_streaming(s->renditions[i].session);
+        if (ret != RTMP_SUCCESS) {
+            SET_ERROR(s, "Rendition %d: %s", i, s->renditions[i].session->error_msg);
+            return ret;
+        }
+    }
+    return RTMP_SUCCESS;
+}
+
+static int ring_init(SPSCRing* r, int slots, int slot_size) {
+    // One extra slot keeps full and empty distinguishable
+    r->capacity = slots + 1;
+    r->slot_size = slot_size;
+    r->slots = av_calloc(r->capacity, sizeof(RingSlot));
+    if (!r->slots) {
+        return RTMP_ERROR_ALLOC_FAILED;
+    }
+    
+    for (int i = 0; i < r->capacity; i++) {
+        r->slots[i].data = av_malloc(slot_size);
+        if (!r->slots[i].data) {
+            for (int j = 0; j < i; j++) {
+                av_freep(&r->slots[j].data);
+            }
+            av_freep(&r->slots);
+            return RTMP_ERROR_ALLOC_FAILED;
+        }
+    }
+    
+    ATOMIC_STORE(&r->read_index, 0);
+    ATOMIC_STORE(&r->write_index, 0);
+    return RTMP_SUCCESS;
+}
+
+static void ring_free(SPSCRing* r) {
+    if (!r->slots) {
+        return;
+    }
+    
+    for (int i = 0; i < r->capacity; i++) {
+        // Zero-copy frames still queued go back to the caller
+        av_buffer_unref(&r->slots[i].external);
+        av_frame_free(&r->slots[i].source);
+        av_freep(&r->slots[i].data);
+    }
+    av_freep(&r->slots);
+    r->capacity = 0;
+}
+
+// Producer: next free slot, or NULL if the ring is full
+static RingSlot* ring_write_slot(SPSCRing* r) {
+    int write = ATOMIC_LOAD(&r->write_index);
+    int next = (write + 1) % r->capacity;
+    if (next == ATOMIC_LOAD(&r->read_index)) {
+        return NULL;
+    }
+    return &r->slots[write];
+}
+
+// Producer: publish the slot returned by ring_write_slot
+static void ring_commit(SPSCRing* r) {
+    int write = ATOMIC_LOAD(&r->write_index);
+    ATOMIC_STORE(&r->write_index, (write + 1) % r->capacity);
+}
+
+// Consumer: oldest published slot, or NULL if the ring is empty
+static RingSlot* ring_read_slot(SPSCRing* r) {
+    int read = ATOMIC_LOAD(&r->read_index);
+    if (read == ATOMIC_LOAD(&r->write_index)) {
+        return NULL;
+    }
+    return &r->slots[read];
+}
+
+// Consumer: hand the slot returned by ring_read_slot back to the producer
+static void ring_release(SPSCRing* r) {
+    int read = ATOMIC_LOAD(&r->read_index);
+    ATOMIC_STORE(&r->read_index, (read + 1) % r->capacity);
+}
+
+// Published slots; exact for the consumer, a lower bound for the producer
+static int ring_count(SPSCRing* r) {
+    int read = ATOMIC_LOAD(&r->read_index);
+    int write = ATOMIC_LOAD(&r->write_index);
+    return (write - read + r->capacity) % r->capacity;
+}
+
+// Frame budget exceeded by the recent average encode time
+static int encoder_overloaded(RTMPSession* s) {
+    int avg = ATOMIC_LOAD(&s->avg_encode_us);
+    return avg > 0 && avg > 1000000 / s->config.fps;
+}
+
+// Consumer: whether the oldest queued frame should be skipped for a newer one
+static int skip_queued_video(RTMPSession* s) {
+    if (ring_count(&s->video_ring) < 2) {
+        return 0;
+    }
+    
+    switch (s->config.skip_policy) {
+        case RTMP_SKIP_KEEP_LATEST: return 1;
+        case RTMP_SKIP_DROP_OLDEST: return encoder_overloaded(s);
+        default: return 0;
+    }
+}
+
+// Producer side: wake the encoder if it is waiting for work. The sleeping
+// flag is only set under wake_mutex right before the encoder re-checks the
+// rings, so a wakeup can never be lost between the check and the wait.
+static void wake_encoder(RTMPSession* s) {
+    if (ATOMIC_LOAD(&s->encoder_sleeping)) {
+        MUTEX_LOCK(s->wake_mutex);
+        COND_SIGNAL(s->wake_cond);
+        MUTEX_UNLOCK(s->wake_mutex);
+    }
+}
+
+// Producer: enter before touching the rings, 0 if they are closed. The
+// count goes up before the open flag is read and stop_encoder_thread clears
+// the flag before reading the count, so one of the two always sees the other.
+static int ring_enter(RTMPSession* s) {
+    ATOMIC_ADD(&s->ring_users, 1);
+    if (!ATOMIC_LOAD(&s->rings_open)) {
+        ATOMIC_ADD(&s->ring_users, -1);
+        return 0;
+    }
+    return 1;
+}
+
+static void ring_leave(RTMPSession* s) {
+    ATOMIC_ADD(&s->ring_users, -1);
+}
+
+static void drain_audio_ring(RTMPSession* s) {
+    RingSlot* slot;
+    int channels = s->config.audio_channels;
+    
+    while ((slot = ring_read_slot(&s->audio_ring)) != NULL) {
+        if (s->audio_codec_ctx && s->state == RTMP_STATE_STREAMING) {
+            int num_samples = slot->size / (int)(sizeof(float) * channels);
+            encode_and_send_audio(s, (const float*)slot->data, num_samples, slot->pts);
+        }
+        ring_release(&s->audio_ring);
+    }
+}
+
+static THREAD_PROC(encoder_thread_main) {
+    RTMPSession* s = (RTMPSession*)arg;
+    
+    while (!ATOMIC_LOAD(&s->encoder_stop)) {
+        // Audio first, it is small and latency sensitive
+        drain_audio_ring(s);
+        
+        RingSlot* slot = ring_read_slot(&s->video_ring);
+        if (slot) {
+            if (skip_queued_video(s)) {
+                ATOMIC_ADD(&s->skipped_frames, 1);
+            } else if (s->state == RTMP_STATE_STREAMING) {
+                int ret;
+                if (slot->source && slot->source->buf[0]) {
+                    ret = encode_rendition_frame(s, slot->source, slot->pts);
+                } else {
+                    VideoInput in;
+                    video_input_from_buffer(s, slot->external ? slot->external->data : slot->data, &in);
+                    ret = encode_and_send_video(s, &in, slot->pts);
+                }
+                if (ret != RTMP_SUCCESS) {
+                    set_async_error(s, ret);
+                }
+            }
+            // The frame has been converted or skipped, a zero-copy buffer can go back now
+            av_buffer_unref(&slot->external);
+            if (slot->source) {
+                av_frame_unref(slot->source);
+            }
+            ring_release(&s->video_ring);
+            continue;
+        }
+        
+        MUTEX_LOCK(s->wake_mutex);
+        ATOMIC_STORE(&s->encoder_sleeping, 1);
+        while (!ATOMIC_LOAD(&s->encoder_stop) &&
+               !ring_read_slot(&s->video_ring) &&
+               !ring_read_slot(&s->audio_ring)) {
+            COND_WAIT(s->wake_cond, s->wake_mutex);
+        }
+        ATOMIC_STORE(&s->encoder_sleeping, 0);
+        MUTEX_UNLOCK(s->wake_mutex);
+    }
+    
+    THREAD_RETURN;
+}
+
+// Called with s->mutex held
+static int start_encoder_thread(RTMPSession* s) {
+    int frame_size = video_frame_size(s);
+    int audio_size = RTMP_AUDIO_SLOT_SAMPLES * s->config.audio_channels * (int)sizeof(float);
+    
+    if (ring_init(&s->video_ring, RTMP_VIDEO_RING_SLOTS, frame_size) != RTMP_SUCCESS ||
+        ring_init(&s->audio_ring, RTMP_AUDIO_RING_SLOTS, audio_size) != RTMP_SUCCESS) {
+        SET_ERROR(s, "Failed to allocate async encode rings");
+        ring_free(&s->video_ring);
+        return RTMP_ERROR_ALLOC_FAILED;
+    }
+    
+    ATOMIC_STORE(&s->encoder_stop, 0);
+    ATOMIC_STORE(&s->encoder_sleeping, 0);
+    set_async_error(s, RTMP_SUCCESS);
+    
+    if (THREAD_CREATE(s->encoder_thread, encoder_thread_main, s) != 0) {
+        SET_ERROR(s, "Failed to start encoder thread");
+        ring_free(&s->video_ring);
+        ring_free(&s->audio_ring);
+        return RTMP_ERROR_INIT_FAILED;
+    }
+    
+    s->encoder_running = 1;
+    return RTMP_SUCCESS;
+}
+
+// Data still in the rings is discarded
+static void stop_encoder_thread(RTMPSession* s) {
+    if (!s->encoder_running) {
+        return;
+    }
+    
+    // No new producers; the ones still copying a frame finish first
+    ATOMIC_STORE(&s->rings_open, 0);
+    while (ATOMIC_LOAD(&s->ring_users) > 0) {
+        av_usleep(100);
+    }
+    
+    MUTEX_LOCK(s->wake_mutex);
+    ATOMIC_STORE(&s->encoder_stop, 1);
+    COND_SIGNAL(s->wake_cond);
+    MUTEX_UNLOCK(s->wake_mutex);
+    
+    THREAD_JOIN(s->encoder_thread);
+    s->encoder_running = 0;
+    
+    ring_free(&s->video_ring);
+    ring_free(&s->audio_ring);
+}
+
+// Producer: RTMP_SKIP_DROP_NEWEST sheds the incoming frame as soon as the
+// encoder is over budget and already has a frame waiting
+static int skip_incoming_video(RTMPSession* s) {
+    return s->config.skip_policy == RTMP_SKIP_DROP_NEWEST &&
+           ring_count(&s->video_ring) > 0 &&
+           encoder_overloaded(s);
+}
+
+static int enqueue_video_frame(RTMPSession* s, const VideoInput* in, int64_t pts) {
+    int ret = take_async_error(s);
+    
+    RingSlot* slot = skip_incoming_video(s) ? NULL : ring_write_slot(&s->video_ring);
+    if (!slot) {
+        // Encoder is behind, skip this frame rather than block the caller
+        ATOMIC_ADD(&s->skipped_frames, 1);
+        return ret;
+    }
+    
+    // Planes are stored tightly packed, so strided input is compacted here
+    int row_bytes[3], rows[3];
+    int planes = video_plane_layout(s, row_bytes, rows);
+    uint8_t* dst = slot->data;
+    for (int i = 0; i < planes; i++) {
+        av_image_copy_plane(dst, row_bytes[i], in->data[i], in->stride[i], row_bytes[i], rows[i]);
+        dst += (size_t)row_bytes[i] * rows[i];
+    }
+    
+    slot->size = (int)(dst - slot->data);
+    slot->pts = pts;
+    ring_commit(&s->video_ring);
+    wake_encoder(s);
+    
+    return ret;
+}
+
+// Queues a zero-copy frame; the ring slot takes over the reference
+static int enqueue_video_buffer(RTMPSession* s, AVBufferRef* buf, int64_t pts) {
+    int ret = take_async_error(s);
+    
+    RingSlot* slot = skip_incoming_video(s) ? NULL : ring_write_slot(&s->video_ring);
+    if (!slot) {
+        ATOMIC_ADD(&s->skipped_frames, 1);
+        av_buffer_unref(&buf);
+        return ret;
+    }
+    
+    slot->external = buf;
+    slot->size = (int)buf->size;
+    slot->pts = pts;
+    ring_commit(&s->video_ring);
+    wake_encoder(s);
+    
+    return ret;
+}
+
+// Queues a reference to a parent session's frame, for a rendition to scale
+static void enqueue_video_source(RTMPSession* s, const AVFrame* frame, int64_t pts) {
+    RingSlot* slot = skip_incoming_video(s) ? NULL : ring_write_slot(&s->video_ring);
+    if (slot && !slot->source) {
+        slot->source = av_frame_alloc();
+    }
+    if (!slot || !slot->source || av_frame_ref(slot->source, frame) < 0) {
+        ATOMIC_ADD(&s->skipped_frames, 1);
+        return;
+    }
+    
+    slot->size = 0;
+    slot->pts = pts;
+    ring_commit(&s->video_ring);
+    wake_encoder(s);
+}
+
+static int enqueue_audio(RTMPSession* s, const float* pcm_data, int num_samples, int64_t pts) {
+    int channels = s->config.audio_channels;
+    int sample_rate = s->config.audio_sample_rate;
+    
+    while (num_samples > 0) {
+        RingSlot* slot = ring_write_slot(&s->audio_ring);
+        if (!slot) {
+            // Encoder is behind; losing a chunk beats stalling the audio thread
+            break;
+        }
+        
+        int chunk = FFMIN(num_samples, RTMP_AUDIO_SLOT_SAMPLES);
+        slot->size = chunk * channels * (int)sizeof(float);
+        slot->pts = pts;
+        memcpy(slot->data, pcm_data, slot->size);
+        ring_commit(&s->audio_ring);
+        
+        pcm_data += chunk * channels;
+        num_samples -= chunk;
+        pts += (int64_t)chunk * 1000 / sample_rate;
+    }
+    
+    wake_encoder(s);
+    return RTMP_SUCCESS;
+}
+
+// Encodes or enqueues one validated frame
+static int submit_video_frame(RTMPSession* s, const VideoInput* in, int64_t pts) {
+    if (s->config.async_encode) {
+        if (!ring_enter(s)) {
+            SET_ERROR(s, "Not streaming");
+            return RTMP_ERROR_NOT_CONNECTED;
+        }
+        int ret = enqueue_video_frame(s, in, pts);
+        ring_leave(s);
+        return ret;
+    }
+    
+    MUTEX_LOCK(s->mutex);
+    
+    if (s->state != RTMP_STATE_STREAMING) {
+        SET_ERROR(s, "Not streaming");
+        MUTEX_UNLOCK(s->mutex);
+        return RTMP_ERROR_NOT_CONNECTED;
+    }
+    
+    // Without a queue every policy sheds the incoming frame. While over
+    // budget, frames are taken one encode time apart, rounded up to whole
+    // frame intervals, so the caller's thread is not blocked frame after frame.
+    int64_t now = av_gettime_relative();
+    int budget_us = 1000000 / s->config.fps;
+    if (now + budget_us / 2 < s->next_sync_encode) {
+        ATOMIC_ADD(&s->skipped_frames, 1);
+        MUTEX_UNLOCK(s->mutex);
+        return take_async_error(s);
+    }
+    
+    int ret = encode_and_send_video(s, in, pts);
+    
+    int avg = ATOMIC_LOAD(&s->avg_encode_us);
+    s->next_sync_encode = encoder_overloaded(s) ? now + (int64_t)((avg + budget_us - 1) / budget_us) * budget_us : 0;
+    
+    MUTEX_UNLOCK(s->mutex);
+    
+    if (ret == RTMP_SUCCESS) {
+        ret = take_async_error(s);
+    }
+    return ret;
+}
+
+RTMP_API int rtmp_session_send_video_frame(RTMPSession* s, const uint8_t* rgba_data, int data_size, int64_t pts) {
+    if (s == NULL || !s->mutex_initialized) {
+        return RTMP_ERROR_INVALID_PARAMS;
+    }
+    
+    if (rgba_data == NULL) {
+        SET_ERROR(s, "Frame data is NULL");
+        return RTMP_ERROR_INVALID_PARAMS;
+    }
+    
+    int expected_size = video_frame_size(s);
+    if (data_size != expected_size) {
+        SET_ERROR(s, "Invalid data size: expected %d, got %d", expected_size, data_size);
+        return RTMP_ERROR_INVALID_PARAMS;
+    }
+    
+    VideoInput in;
+    video_input_from_buffer(s, rgba_data, &in);
+    return submit_video_frame(s, &in, pts);
+}
+
+static void release_external_frame(void* opaque, uint8_t* data) {
+    ExternalFrame* ext = (ExternalFrame*)opaque;
+    ext->release(ext->opaque, data);
+    av_free(ext);
+}
+
+RTMP_API int rtmp_session_submit_video_frame(
+    RTMPSession* s,
+    const uint8_t* data, int data_size,
+    RTMPReleaseCallback release, void* opaque,
+    int64_t pts
+) {
+    if (release == NULL) {
+        return rtmp_session_send_video_frame(s, data, data_size, pts);
+    }
+    
+    if (s == NULL || !s->mutex_initialized || data == NULL) {
+        release(opaque, data);
+        return RTMP_ERROR_INVALID_PARAMS;
+    }
+    
+    int expected_size = video_frame_size(s);
+    if (data_size != expected_size) {
+        SET_ERROR(s, "Invalid data size: expected %d, got %d", expected_size, data_size);
+        release(opaque, data);
+        return RTMP_ERROR_INVALID_PARAMS;
+    }
+    
+    // From here on the AVBufferRef owns the frame and calls release when freed
+    ExternalFrame* ext = av_malloc(sizeof(ExternalFrame));
+    AVBufferRef* buf = NULL;
+    if (ext) {
+        ext->release = release;
+        ext->opaque = opaque;
+        buf = av_buffer_create((uint8_t*)data, data_size, release_external_frame, ext, AV_BUFFER_FLAG_READONLY);
+    }
+    if (!buf) {
+        SET_ERROR(s, "Failed to wrap frame buffer");
+        av_free(ext);
+        release(opaque, data);
+        return RTMP_ERROR_ALLOC_FAILED;
+    }
+    
+    if (s->config.async_encode) {
+        if (!ring_enter(s)) {
+            SET_ERROR(s, "Not streaming");
+            av_buffer_unref(&buf);
+            return RTMP_ERROR_NOT_CONNECTED;
+        }
+        int ret = enqueue_video_buffer(s, buf, pts);
+        ring_leave(s);
+        return ret;
+    }
+    
+    VideoInput in;
+    video_input_from_buffer(s, buf->data, &in);
+    int ret = submit_video_frame(s, &in, pts);
+    av_buffer_unref(&buf);
+    return ret;
+}
+
+static int frame_pool_init(RTMPSession* s) {
+    int size = video_frame_size(s);
+    
+    for (int i = 0; i < RTMP_FRAME_POOL_BUFFERS; i++) {
+        FrameBuffer* fb = &s->frame_pool[i];
+        fb->raw = av_malloc((size_t)size + RTMP_FRAME_POOL_ALIGN - 1);
+        if (!fb->raw) {
+            frame_pool_free(s);
+            return RTMP_ERROR_ALLOC_FAILED;
+        }
+        fb->data = (uint8_t*)(((uintptr_t)fb->raw + RTMP_FRAME_POOL_ALIGN - 1) & ~(uintptr_t)(RTMP_FRAME_POOL_ALIGN - 1));
+        ATOMIC_STORE(&fb->state, FRAME_BUFFER_FREE);
+    }
+    
+    ATOMIC_STORE(&s->frame_pool_size, size);
+    return RTMP_SUCCESS;
+}
+
+static void frame_pool_free(RTMPSession* s) {
+    for (int i = 0; i < RTMP_FRAME_POOL_BUFFERS; i++) {
+        av_freep(&s->frame_pool[i].raw);
+        s->frame_pool[i].data = NULL;
+    }
+    ATOMIC_STORE(&s->frame_pool_size, 0);
+}
+
+static FrameBuffer* frame_pool_find(RTMPSession* s, const uint8_t* data) {
+    for (int i = 0; i < RTMP_FRAME_POOL_BUFFERS; i++) {
+        if (data != NULL && s->frame_pool[i].data == data) {
+            return &s->frame_pool[i];
+        }
+    }
+    return NULL;
+}
+
+// Release callback for submitted pool buffers
+static void frame_pool_release(void* opaque, const uint8_t* data) {
+    FrameBuffer* fb = (FrameBuffer*)opaque;
+    (void)data;
+    ATOMIC_STORE(&fb->state, FRAME_BUFFER_FREE);
+}
+
+RTMP_API uint8_t* rtmp_session_acquire_frame_buffer(RTMPSession* s, int* size) {
+    // Renditions are fed by their parent, never from a pool
+    if (s == NULL || !s->mutex_initialized || s->is_rendition) {
+        return NULL;
+    }
+    
+    int pool_size = ATOMIC_LOAD(&s->frame_pool_size);
+    if (pool_size == 0) {
+        // First borrow allocates the pool; another thread may have beaten us to it
+        MUTEX_LOCK(s->mutex);
+        if (s->state != RTMP_STATE_IDLE && ATOMIC_LOAD(&s->frame_pool_size) == 0) {
+            if (frame_pool_init(s) != RTMP_SUCCESS) {
+                SET_ERROR(s, "Failed to allocate frame buffer pool");
+            }
+        }
+        pool_size = ATOMIC_LOAD(&s->frame_pool_size);
+        MUTEX_UNLOCK(s->mutex);
+        if (pool_size == 0) {
+            return NULL;
+        }
+    }
+    
+    for (int i = 0; i < RTMP_FRAME_POOL_BUFFERS; i++) {
+        FrameBuffer* fb = &s->frame_pool[i];
+        if (ATOMIC_CAS(&fb->state, FRAME_BUFFER_FREE, FRAME_BUFFER_ACQUIRED)) {
+            if (size) {
+                *size = pool_size;
+            }
+            return fb->data;
+        }
+    }
+    
+    // Every buffer is queued or lent out; the encoder is behind
+    return NULL;
+}
+
+RTMP_API int rtmp_session_submit_frame_buffer(RTMPSession* s, uint8_t* buffer, int64_t pts) {
+    if (s == NULL || !s->mutex_initialized) {
+        return RTMP_ERROR_INVALID_PARAMS;
+    }
+    
+    FrameBuffer* fb = frame_pool_find(s, buffer);
+    if (!fb || !ATOMIC_CAS(&fb->state, FRAME_BUFFER_ACQUIRED, FRAME_BUFFER_QUEUED)) {
+        SET_ERROR(s, "Buffer was not acquired from this session");
+        return RTMP_ERROR_INVALID_PARAMS;
+    }
+    
+    // Zero-copy: the buffer returns to the pool once the encoder is done with it
+    return rtmp_session_submit_video_frame(s, buffer, ATOMIC_LOAD(&s->frame_pool_size), frame_pool_release, fb, pts);
+}
+
+RTMP_API int rtmp_session_release_frame_buffer(RTMPSession* s, uint8_t* buffer) {
+    if (s == NULL) {
+        return RTMP_ERROR_INVALID_PARAMS;
+    }
+    
+    FrameBuffer* fb = frame_pool_find(s, buffer);
+    if (!fb || !ATOMIC_CAS(&fb->state, FRAME_BUFFER_ACQUIRED, FRAME_BUFFER_FREE)) {
+        SET_ERROR(s, "Buffer was not acquired from this session");
+        return RTMP_ERROR_INVALID_PARAMS;
+    }
+    return RTMP_SUCCESS;
+}
+
+RTMP_API int rtmp_session_send_video_planes(
+    RTMPSession* s,
+    const uint8_t* plane0, int stride0,
+    const uint8_t* plane1, int stride1,
+    const uint8_t* plane2, int stride2,
+    int64_t pts
+) {
+    if (s == NULL || !s->mutex_initialized) {
+        return RTMP_ERROR_INVALID_PARAMS;
+    }
+    
+    VideoInput in = {
+        { plane0, plane1, plane2 },
+        { stride0, stride1, stride2 }
+    };
+    
+    int row_bytes[3], rows[3];
+    int planes = video_plane_layout(s, row_bytes, rows);
+    for (int i = 0; i < planes; i++) {
+        if (in.data[i] == NULL || in.stride[i] < row_bytes[i]) {
+            SET_ERROR(s, "Invalid plane %d: stride %d, need at least %d bytes per row", i, in.stride[i], row_bytes[i]);
+            return RTMP_ERROR_INVALID_PARAMS;
+        }
+    }
+    for (int i = planes; i < 3; i++) {
+        in.data[i] = NULL;
+        in.stride[i] = 0;
+    }
+    
+    return submit_video_frame(s, &in, pts);
+}
+
+RTMP_API int rtmp_session_send_video_region(
+    RTMPSession* s,
+    const uint8_t* data, int stride,
+    int crop_x, int crop_y, int crop_width, int crop_height,
+    int64_t pts
+) {
+    if (s == NULL || !s->mutex_initialized) {
+        return RTMP_ERROR_INVALID_PARAMS;
+    }
+    
+    if (data == NULL) {
+        SET_ERROR(s, "Frame data is NULL");
+        return RTMP_ERROR_INVALID_PARAMS;
+    }
+    
+    if (s->config.pixel_format == RTMP_PIXEL_FORMAT_NV12 || s->config.pixel_format == RTMP_PIXEL_FORMAT_I420) {
+        SET_ERROR(s, "Regions need a packed pixel format, use rtmp_send_video_planes for NV12/I420");
+        return RTMP_ERROR_INVALID_PARAMS;
+    }
+    
+    // The encoder does not scale, so the region must match the configured size
+    if (crop_width != s->config.width || crop_height != s->config.height) {
+        SET_ERROR(s, "Invalid region size: expected %dx%d, got %dx%d",
+                  s->config.width, s->config.height, crop_width, crop_height);
+        return RTMP_ERROR_INVALID_PARAMS;
+    }
+    
+    if (crop_x < 0 || crop_y < 0 || stride < (crop_x + crop_width) * 4) {
+        SET_ERROR(s, "Invalid region origin %d,%d for stride %d", crop_x, crop_y, stride);
+        return RTMP_ERROR_INVALID_PARAMS;
+    }
+    
+    VideoInput in = {
+        { data + (size_t)crop_y * stride + (size_t)crop_x * 4, NULL, NULL },
+        { stride, 0, 0 }
+    };
+    return submit_video_frame(s, &in, pts);
+}
+
+#ifdef RTMP_VERIFY_COLORCONV
+// Logs the largest per-sample deviation from swscale whenever it grows
+static void verify_colorconv(RTMPSession* s, const uint8_t* src, int src_stride) {
+    const uint8_t* src_data[1] = { src };
+    int src_linesize[1] = { src_stride };
+    
+    if (!s->sws_ctx || !s->verify_frame->data[0]) {
+        return;
+    }
+    
+    sws_scale(
+        s->sws_ctx,
+        src_data, src_linesize, 0, s->config.height,
+        s->verify_frame->data, s->verify_frame->linesize
+    );
+    
+    int max_diff = 0;
+    for (int plane = 0; plane < 3; plane++) {
+        int w = plane ? (s->config.width + 1) / 2 : s->config.width;
+        int h = plane ? (s->config.height + 1) / 2 : s->config.height;
+        for (int y = 0; y < h; y++) {
+            const uint8_t* a = s->video_frame->data[plane] + y * s->video_frame->linesize[plane];
+            const uint8_t* b = s->verify_frame->data[plane] + y * s->verify_frame->linesize[plane];
+            for (int x = 0; x < w; x++) {
+                int d = abs((int)a[x] - (int)b[x]);
+                if (d > max_diff) {
+                    max_diff = d;
+                }
+            }
+        }
+    }
+    
+    if (max_diff > s->verify_max_diff) {
+        s->verify_max_diff = max_diff;
+        fprintf(stderr, "[ffmpeg_rtmp] colorconv (%s) max deviation from swscale: %d\n",
+                rtmp_colorconv_init(), max_diff);
+    }
+}
+#endif
+
+// Runs on the thread that encodes, so the codec context is never changed
+// under a frame in progress. The encoder picks the new rate up on this frame,
+// without a new keyframe; the reported bitrate only follows when it does.
+static void apply_pending_bitrate(RTMPSession* s) {
+    int bitrate_kbps = ATOMIC_EXCHANGE(&s->pending_bitrate_kbps, 0);
+    if (bitrate_kbps <= 0 || bitrate_kbps == s->config.bitrate_kbps || !s->encoder_runtime_bitrate) {
+        return;
+    }
+    
+    s->config.bitrate_kbps = bitrate_kbps;
+    set_video_rate(s, s->video_codec_ctx, bitrate_kbps);
+}
+
+// Exponential moving average over roughly the last eight frames
+static void update_encode_time(RTMPSession* s, int64_t encode_us) {
+    int avg = ATOMIC_LOAD(&s->avg_encode_us);
+    int sample = (int)FFMIN(encode_us, INT32_MAX);
+    ATOMIC_STORE(&s->avg_encode_us, avg == 0 ? sample : avg + (sample - avg) / 8);
+}
+
+// Hands back the frame the encoder takes: video_frame itself, its NV12
+// copy for NV12-only encoders, or its upload to the encoder's device
+static int encoder_input_frame(RTMPSession* s, AVFrame** out) {
+    AVFrame* frame = s->video_frame;
+    int ret;
+    
+    if (s->upload_frame) {
+        ret = av_frame_make_writable(s->upload_frame);
+        if (ret < 0) {
+            SET_ERROR(s, "Failed to make frame writable: %s", av_err2str(ret));
+            return RTMP_ERROR_ENCODE_FAILED;
+        }
+        
+        rtmp_i420_to_nv12(
+            frame->data[0], frame->linesize[0],
+            frame->data[1], frame->linesize[1],
+            frame->data[2], frame->linesize[2],
+            s->upload_frame->data[0], s->upload_frame->linesize[0],
+            s->upload_frame->data[1], s->upload_frame->linesize[1],
+            s->config.width, s->config.height
+        );
+        frame = s->upload_frame;
+    }
+    
+    if (s->hw_frame) {
+        // The encoder still holds the previous upload, so take a fresh surface
+        av_frame_unref(s->hw_frame);
+        ret = av_hwframe_get_buffer(s->video_codec_ctx->hw_frames_ctx, s->hw_frame, 0);
+        if (ret >= 0) {
+            ret = av_hwframe_transfer_data(s->hw_frame, frame, 0);
+        }
+        if (ret < 0) {
+            SET_ERROR(s, "Failed to upload frame to the encoder device: %s", av_err2str(ret));
+            return RTMP_ERROR_ENCODE_FAILED;
+        }
+        frame = s->hw_frame;
+    }
+    
+    *out = frame;
+    return RTMP_SUCCESS;
+}
+
+// Gives video_frame buffers of its own before they are overwritten. Unlike
+// av_frame_make_writable, buffers still referenced elsewhere (by renditions)
+// are replaced without copying contents that are about to be overwritten.
+static int renew_video_frame(AVFrame* frame) {
+    if (av_frame_is_writable(frame)) {
+        return 0;
+    }
+    
+    int format = frame->format;
+    int width = frame->width;
+    int height = frame->height;
+    av_frame_unref(frame);
+    frame->format = format;
+    frame->width = width;
+    frame->height = height;
+    return av_frame_get_buffer(frame, 0);
+}
+
+// Encodes video_frame once it holds the new picture, and queues the packets
+static int encode_video_frame(RTMPSession* s, int64_t pts, int64_t encode_start) {
+    AVFrame* frame;
+    int ret = encoder_input_frame(s, &frame);
+    if (ret != RTMP_SUCCESS) {
+        return ret;
+    }
+    
+    // Set PTS
+    frame->pts = av_rescale_q(
+        pts,
+        (AVRational){1, 1000}, // Input is in milliseconds
+        s->video_codec_ctx->time_base
+    );
+    
+    // The frame is reused, so clear the type again after a forced keyframe
+    frame->pict_type = ATOMIC_EXCHANGE(&s->keyframe_requested, 0) ? AV_PICTURE_TYPE_I : AV_PICTURE_TYPE_NONE;
+    
+    // Send frame to encoder
+    ret = avcodec_send_frame(s->video_codec_ctx, frame);
+    if (ret < 0) {
+        SET_ERROR(s, "Failed to send frame to encoder: %s", av_err2str(ret));
+        return RTMP_ERROR_ENCODE_FAILED;
+    }
+    
+    // Receive and write encoded packets
+    while (ret >= 0) {
+        ret = avcodec_receive_packet(s->video_codec_ctx, s->packet);
+        if (ret == AVERROR(EAGAIN) || ret == AVERROR_EOF) {
+            break;
+        } else if (ret < 0) {
+            SET_ERROR(s, "Error receiving packet: %s", av_err2str(ret));
+            return RTMP_ERROR_ENCODE_FAILED;
+        }
+        
+        // Rescale timestamps
+        av_packet_rescale_ts(s->packet, s->video_codec_ctx->time_base, s->video_stream->time_base);
+        s->packet->stream_index = s->video_stream->index;
+        
+        // Hand off to the sender thread; a full queue drops instead of blocking
+        send_packet(s, s->packet);
+    }
+    
+    ATOMIC_ADD(&s->frames_sent, 1);
+    update_encode_time(s, av_gettime_relative() - encode_start);
+    return RTMP_SUCCESS;
+}
+
+// Rendition encoder thread: scales the parent's frame straight into video_frame
+static int encode_rendition_frame(RTMPSession* s, const AVFrame* source, int64_t pts) {
+    int64_t encode_start = av_gettime_relative();
+    
+    apply_pending_bitrate(s);
+    
+    int ret = renew_video_frame(s->video_frame);
+    if (ret < 0) {
+        SET_ERROR(s, "Failed to make frame writable: %s", av_err2str(ret));
+        return RTMP_ERROR_ENCODE_FAILED;
+    }
+    
+    // The parent's frame layout is fixed for the connection
+    if (!s->source_sws) {
+        s->source_sws = sws_getContext(
+            source->width, source->height, source->format,
+            s->video_frame->width, s->video_frame->height, s->video_frame->format,
+            SWS_BILINEAR, NULL, NULL, NULL
+        );
+        if (!s->source_sws) {
+            SET_ERROR(s, "Failed to create %dx%d rendition scaler", s->video_frame->width, s->video_frame->height);
+            return RTMP_ERROR_ENCODE_FAILED;
+        }
+    }
+    
+    sws_scale(
+        s->source_sws,
+        (const uint8_t* const*)source->data, source->linesize, 0, source->height,
+        s->video_frame->data, s->video_frame->linesize
+    );
+    
+    return encode_video_frame(s, pts, encode_start);
+}
+
+static int encode_and_send_video(RTMPSession* s, const VideoInput* in, int64_t pts) {
+    int ret;
+    int64_t encode_start = av_gettime_relative();
+    
+    apply_pending_bitrate(s);
+    
+    // Make frame writable
+    ret = renew_video_frame(s->video_frame);
+    if (ret < 0) {
+        SET_ERROR(s, "Failed to make frame writable: %s", av_err2str(ret));
+        return RTMP_ERROR_ENCODE_FAILED;
+    }
+    
+    // Bottom-up input is read with a negative stride starting at the last
+    // row of each plane, so flipping costs nothing extra.
+    int row_bytes[3], rows[3];
+    int planes = video_plane_layout(s, row_bytes, rows);
+    VideoInput src = *in;
+    if (s->config.flip_vertical) {
+        for (int i = 0; i < planes; i++) {
+            src.data[i] += (ptrdiff_t)(rows[i] - 1) * src.stride[i];
+            src.stride[i] = -src.stride[i];
+        }
+    }
+    
+    AVFrame* frame = s->video_frame;
+    switch (s->config.pixel_format) {
+        case RTMP_PIXEL_FORMAT_NV12:
+            if (frame->format != AV_PIX_FMT_NV12) {
+                // The encoder only takes I420
+                rtmp_nv12_to_i420(
+                    src.data[0], src.stride[0],
+                    src.data[1], src.stride[1],
+                    frame->data[0], frame->linesize[0],
+                    frame->data[1], frame->linesize[1],
+                    frame->data[2], frame->linesize[2],
+                    s->config.width, s->config.height
+                );
+                break;
+            }
+            // fall through
+        case RTMP_PIXEL_FORMAT_I420:
+            // Already in the encoder's layout, just copy the planes
+            for (int i = 0; i < planes; i++) {
+                av_image_copy_plane(
+                    frame->data[i], frame->linesize[i],
+                    src.data[i], src.stride[i],
+                    row_bytes[i], rows[i]
+                );
+            }
+            break;
+        case RTMP_PIXEL_FORMAT_BGRA:
+            rtmp_bgra_to_i420(
+                src.data[0], src.stride[0],
+                frame->data[0], frame->linesize[0],
+                frame->data[1], frame->linesize[1],
+                frame->data[2], frame->linesize[2],
+                s->config.width, s->config.height
+            );
+            break;
+        case RTMP_PIXEL_FORMAT_ARGB:
+            rtmp_argb_to_i420(
+                src.data[0], src.stride[0],
+                frame->data[0], frame->linesize[0],
+                frame->data[1], frame->linesize[1],
+                frame->data[2], frame->linesize[2],
+                s->config.width, s->config.height
+            );
+            break;
+        default:
+            rtmp_rgba_to_i420(
+                src.data[0], src.stride[0],
+                frame->data[0], frame->linesize[0],
+                frame->data[1], frame->linesize[1],
+                frame->data[2], frame->linesize[2],
+                s->config.width, s->config.height
+            );
+            break;
+    }
+    
+#ifdef RTMP_VERIFY_COLORCONV
+    // No-op for NV12/I420, which have no reference scaler
+    verify_colorconv(s, src.data[0], src.stride[0]);
+#endif
+    
+    feed_renditions(s, pts);
+    
+    return encode_video_frame(s, pts, encode_start);
+}
+
+RTMP_API int rtmp_session_send_audio(RTMPSession* s, const float* pcm_data, int num_samples, int64_t pts) {
+    if (s == NULL || !s->mutex_initialized || pcm_data == NULL || num_samples <= 0) {
+        return RTMP_ERROR_INVALID_PARAMS;
+    }
+    
+    // Every rendition carries the same audio (their encoders only queue it)
+    for (int i = 0; i < s->rendition_count; i++) {
+        rtmp_session_send_audio(s->renditions[i].session, pcm_data, num_samples, pts);
+    }
+    
+    if (s->config.async_encode) {
+        if (!ring_enter(s)) {
+            return RTMP_SUCCESS; // Audio is optional
+        }
+        int ret = enqueue_audio(s, pcm_data, num_samples, pts);
+        ring_leave(s);
+        return ret;
+    }
+    
+    MUTEX_LOCK(s->mutex);
+    
+    if (s->state != RTMP_STATE_STREAMING || !s->audio_codec_ctx) {
+        MUTEX_UNLOCK(s->mutex);
+        return RTMP_SUCCESS; // Audio is optional
+    }
+    
+    int ret = encode_and_send_audio(s, pcm_data, num_samples, pts);
+    
+    MUTEX_UNLOCK(s->mutex);
+    return ret;
+}
+
+static int encode_and_send_audio(RTMPSession* s, const float* pcm_data, int num_samples, int64_t pts) {
+    int ret;
+    
+    // Make frame writable
+    ret = av_frame_make_writable(s->audio_frame);
+    if (ret < 0) {
+        return RTMP_ERROR_ENCODE_FAILED;
+    }
+    
+    // Resample audio
+    const uint8_t* in_data[1] = { (const uint8_t*)pcm_data };
+    
+    ret = swr_convert(
+        s->swr_ctx,
+        s->audio_frame->data,
+        s->audio_frame->nb_samples,
+        in_data,
+        num_samples
+    );
+    
+    if (ret < 0) {
+        return RTMP_ERROR_ENCODE_FAILED;
+    }
+    
+    // Set PTS
+    s->audio_frame->pts = av_rescale_q(
+        pts,
+        (AVRational){1, 1000},
+        s->audio_codec_ctx->time_base
+    );
+    
+    // Send frame to encoder
+    ret = avcodec_send_frame(s->audio_codec_ctx, s->audio_frame);
+    if (ret < 0) {
+        return RTMP_ERROR_ENCODE_FAILED;
+    }
+    
+    // Receive and write packets
+    while (ret >= 0) {
+        ret = avcodec_receive_packet(s->audio_codec_ctx, s->packet);
+        if (ret == AVERROR(EAGAIN) || ret == AVERROR_EOF) {
+            break;
+        } else if (ret < 0) {
+            return RTMP_ERROR_ENCODE_FAILED;
+        }
+        
+        av_packet_rescale_ts(s->packet, s->audio_codec_ctx->time_base, s->audio_stream->time_base);
+        s->packet->stream_index = s->audio_stream->index;
+        
+        send_packet(s, s->packet);
+    }
+    
+    return RTMP_SUCCESS;
+}
+
+RTMP_API int rtmp_session_set_video_bitrate(RTMPSession* s, int bitrate_kbps) {
+    if (s == NULL || !s->mutex_initialized) {
+        return RTMP_ERROR_INVALID_PARAMS;
+    }
+    
+    if (bitrate_kbps <= 0) {
+        SET_ERROR(s, "Invalid bitrate: %dkbps", bitrate_kbps);
+        return RTMP_ERROR_INVALID_PARAMS;
+    }
+    
+    // One hold: the state can't move to streaming between the check and the write
+    MUTEX_LOCK(s->mutex);
+    
+    if (s->state == RTMP_STATE_CONNECTING) {
+        // The connect thread opens the encoder from config outside the lock
+        SET_ERROR(s, "Cannot change bitrate while connecting");
+        MUTEX_UNLOCK(s->mutex);
+        return RTMP_ERROR_NOT_CONNECTED;
+    }
+    
+    if (s->video_codec_ctx && !s->encoder_runtime_bitrate) {
+        // The open encoder would keep its old rate while stats report the new one
+        SET_ERROR(s, "%s cannot change bitrate while connected", s->video_encoder);
+        MUTEX_UNLOCK(s->mutex);
+        return RTMP_ERROR_NOT_SUPPORTED;
+    }
+    
+    // With adaptive bitrate this is the ceiling; the controller ramps from here
+    ATOMIC_STORE(&s->abr.max_kbps, bitrate_kbps);
+    
+    if (s->state == RTMP_STATE_STREAMING) {
+        // Picked up before the next frame is encoded
+        ATOMIC_STORE(&s->pending_bitrate_kbps, bitrate_kbps);
+    } else {
+        // No frame is being encoded, the context can be updated directly
+        s->config.bitrate_kbps = bitrate_kbps;
+        if (s->video_codec_ctx) {
+            set_video_rate(s, s->video_codec_ctx, bitrate_kbps);
+        }
+    }
+    
+    MUTEX_UNLOCK(s->mutex);
+    return RTMP_SUCCESS;
+}
+
+RTMP_API int rtmp_session_request_keyframe(RTMPSession* s) {
+    if (s == NULL || !s->mutex_initialized) {
+        return RTMP_ERROR_INVALID_PARAMS;
+    }
+    
+    // Picked up by whichever thread encodes the next video frame
+    ATOMIC_STORE(&s->keyframe_requested, 1);
+    for (int i = 0; i < s->rendition_count; i++) {
+        rtmp_session_request_keyframe(s->renditions[i].session);
+    }
+    return RTMP_SUCCESS;
+}
+
+RTMP_API int rtmp_session_add_rendition(RTMPSession* s, const char* url, int width, int height, int bitrate_kbps) {
+    if (s == NULL || !s->mutex_initialized) {
+        return RTMP_ERROR_INVALID_PARAMS;
+    }
+    
+    if (url == NULL || strlen(url) == 0) {
+        SET_ERROR(s, "URL is NULL or empty");
+        return RTMP_ERROR_INVALID_PARAMS;
+    }
+    
+    MUTEX_LOCK(s->mutex);
+    
+    if (s->state != RTMP_STATE_INITIALIZED) {
+        SET_ERROR(s, "Add renditions after rtmp_init and before rtmp_connect");
+        MUTEX_UNLOCK(s->mutex);
+        return RTMP_ERROR_NOT_CONNECTED;
+    }
+    
+    if (s->rendition_count >= RTMP_MAX_RENDITIONS) {
+        SET_ERROR(s, "Too many renditions (max %d)", RTMP_MAX_RENDITIONS);
+        MUTEX_UNLOCK(s->mutex);
+        return RTMP_ERROR_INVALID_PARAMS;
+    }
+    
+    // 4:2:0 encoders need even sizes
+    width &= ~1;
+    height &= ~1;
+    if (width <= 0 || height <= 0 || width > s->config.width || height > s->config.height || bitrate_kbps <= 0) {
+        SET_ERROR(s, "Invalid rendition: %dx%d, %dkbps (must fit in %dx%d)", width, height, bitrate_kbps, s->config.width, s->config.height);
+        MUTEX_UNLOCK(s->mutex);
+        return RTMP_ERROR_INVALID_PARAMS;
+    }
+    
+    // Everything else follows the main stream. Frames arrive already
+    // converted and flipped, and are encoded on the rendition's own thread.
+    RTMPConfig config = s->config;
+    config.width = width;
+    config.height = height;
+    config.bitrate_kbps = bitrate_kbps;
+    config.min_bitrate_kbps = 0;
+    config.pixel_format = RTMP_PIXEL_FORMAT_I420;
+    config.flip_vertical = 0;
+    config.async_encode = 1;
+    config.replay_buffer_seconds = 0;
+    
+    Rendition* r = &s->renditions[s->rendition_count];
+    r->session = rtmp_session_create();
+    r->url = av_strdup(url);
+    if (!r->session || !r->url) {
+        SET_ERROR(s, "Failed to allocate rendition");
+        rtmp_session_destroy(r->session);
+        av_freep(&r->url);
+        r->session = NULL;
+        MUTEX_UNLOCK(s->mutex);
+        return RTMP_ERROR_ALLOC_FAILED;
+    }
+    
+    int ret = rtmp_session_init(r->session, &config);
+    if (ret != RTMP_SUCCESS) {
+        SET_ERROR(s, "Rendition %dx%d: %s", width, height, r->session->error_msg);
+        rtmp_session_destroy(r->session);
+        av_freep(&r->url);
+        r->session = NULL;
+        MUTEX_UNLOCK(s->mutex);
+        return ret;
+    }
+    r->session->is_rendition = 1;
+    
+    s->rendition_count++;
+    MUTEX_UNLOCK(s->mutex);
+    return RTMP_SUCCESS;
+}
+
+RTMP_API int rtmp_session_add_destination(RTMPSession* s, const char* url) {
+    if (s == NULL || !s->mutex_initialized) {
+        return RTMP_ERROR_INVALID_PARAMS;
+    }
+    
+    if (url == NULL || strlen(url) == 0) {
+        SET_ERROR(s, "URL is NULL or empty");
+        return RTMP_ERROR_INVALID_PARAMS;
+    }
+    
+    MUTEX_LOCK(s->mutex);
+    
+    if (s->state != RTMP_STATE_INITIALIZED) {
+        SET_ERROR(s, "Add destinations after rtmp_init and before rtmp_connect");
+        MUTEX_UNLOCK(s->mutex);
+        return RTMP_ERROR_NOT_CONNECTED;
+    }
+    
+    if (s->destination_count >= RTMP_MAX_DESTINATIONS) {
+        SET_ERROR(s, "Too many destinations (max %d)", RTMP_MAX_DESTINATIONS);
+        MUTEX_UNLOCK(s->mutex);
+        return RTMP_ERROR_INVALID_PARAMS;
+    }
+    
+    Output* o = &s->destinations[s->destination_count];
+    memset(o, 0, sizeof(*o));
+    o->url = av_strdup(url);
+    if (!o->url) {
+        SET_ERROR(s, "Failed to allocate destination");
+        MUTEX_UNLOCK(s->mutex);
+        return RTMP_ERROR_ALLOC_FAILED;
+    }
+    ATOMIC_STORE(&o->state, RTMP_STATE_INITIALIZED);
+    s->destination_count++;
+    
+    MUTEX_UNLOCK(s->mutex);
+    return RTMP_SUCCESS;
+}
+
+RTMP_API int rtmp_session_start_recording(RTMPSession* s, const char* path) {
+    if (s == NULL || !s->mutex_initialized) {
+        return RTMP_ERROR_INVALID_PARAMS;
+    }
+    
+    if (path == NULL || strlen(path) == 0) {
+        SET_ERROR(s, "Path is NULL or empty");
+        return RTMP_ERROR_INVALID_PARAMS;
+    }
+    
+    MUTEX_LOCK(s->mutex);
+    
+    if (s->state != RTMP_STATE_CONNECTED && s->state != RTMP_STATE_STREAMING) {
+        SET_ERROR(s, "Not connected. Call rtmp_connect first.");
+        MUTEX_UNLOCK(s->mutex);
+        return RTMP_ERROR_NOT_CONNECTED;
+    }
+    
+    if (s->recording.running) {
+        SET_ERROR(s, "Already recording to %s", s->recording.url);
+        MUTEX_UNLOCK(s->mutex);
+        return RTMP_ERROR_INVALID_PARAMS;
+    }
+    
+    Output* o = &s->recording;
+    o->url = av_strdup(path);
+    if (!o->url) {
+        SET_ERROR(s, "Failed to allocate recording");
+        MUTEX_UNLOCK(s->mutex);
+        return RTMP_ERROR_ALLOC_FAILED;
+    }
+    
+    // Container from the file extension. Fragmented MP4 keeps everything
+    // written so far playable if the app dies before stop_recording.
+    AVDictionary* opts = NULL;
+    av_dict_set(&opts, "movflags", "frag_keyframe+empty_moov+default_base_moof", 0);
+    
+    MUTEX_LOCK(s->recording_mutex);
+    int ret = open_output(s, o, NULL, &opts, NULL);
+    MUTEX_UNLOCK(s->recording_mutex);
+    av_dict_free(&opts);
+    
+    if (ret != RTMP_SUCCESS) {
+        av_freep(&o->url);
+        MUTEX_UNLOCK(s->mutex);
+        return ret;
+    }
+    
+    // The file starts at a keyframe; don't wait a whole GOP for it
+    ATOMIC_STORE(&s->keyframe_requested, 1);
+    
+    MUTEX_UNLOCK(s->mutex);
+    return RTMP_SUCCESS;
+}
+
+RTMP_API int rtmp_session_stop_recording(RTMPSession* s) {
+    if (s == NULL || !s->mutex_initialized) {
+        return RTMP_ERROR_INVALID_PARAMS;
+    }
+    
+    MUTEX_LOCK(s->mutex);
+    stop_recording(s);
+    MUTEX_UNLOCK(s->mutex);
+    return RTMP_SUCCESS;
+}
+
+RTMP_API int rtmp_session_save_replay(RTMPSession* s, const char* path, int seconds) {
+    if (s == NULL || !s->mutex_initialized) {
+        return RTMP_ERROR_INVALID_PARAMS;
+    }
+    
+    if (path == NULL || strlen(path) == 0 || seconds <= 0) {
+        SET_ERROR(s, "Invalid replay: path must be set and seconds > 0");
+        return RTMP_ERROR_INVALID_PARAMS;
+    }
+    
+    if (s->config.replay_buffer_seconds <= 0) {
+        SET_ERROR(s, "Replay buffer is off (config.replay_buffer_seconds)");
+        return RTMP_ERROR_INVALID_PARAMS;
+    }
+    
+    AVPacket** packets = NULL;
+    int count = 0;
+    int ret = replay_snapshot(s, seconds, &packets, &count);
+    if (ret != RTMP_SUCCESS) {
+        return ret;
+    }
+    
+    // The next connect replaces the stream layout, so copy it under the lock
+    AVFormatContext* oc = NULL;
+    AVRational time_base[2];
+    int video_index = 0;
+    int64_t start_us = 0;
+    
+    MUTEX_LOCK(s->replay_mutex);
+    ret = avformat_alloc_output_context2(&oc, NULL, NULL, path);
+    for (int i = 0; ret >= 0 && i < s->replay.nb_streams; i++) {
+        AVStream* st = avformat_new_stream(oc, NULL);
+        if (!st || avcodec_parameters_copy(st->codecpar, s->replay.codecpar[i]) < 0) {
+            ret = AVERROR(ENOMEM);
+            break;
+        }
+        st->codecpar->codec_tag = 0;
+        st->time_base = s->replay.time_base[i];
+        time_base[i] = s->replay.time_base[i];
+    }
+    if (ret >= 0) {
+        video_index = s->replay.video_stream_index;
+        start_us = replay_time_us(&s->replay, packets[0]);
+    }
+    MUTEX_UNLOCK(s->replay_mutex);
+    
+    if (ret < 0 || !oc) {
+        SET_ERROR(s, "Failed to create replay file %s: %s", path, av_err2str(ret));
+        ret = RTMP_ERROR_INIT_FAILED;
+        goto done;
+    }
+    
+    if (!(oc->oformat->flags & AVFMT_NOFILE)) {
+        ret = avio_open2(&oc->pb, path, AVIO_FLAG_WRITE, NULL, NULL);
+        if (ret < 0) {
+            SET_ERROR(s, "Failed to open %s: %s", path, av_err2str(ret));
+            ret = RTMP_ERROR_INIT_FAILED;
+            goto done;
+        }
+    }
+    
+    // A finished clip, so put the index up front for quick seeking
+    AVDictionary* opts = NULL;
+    av_dict_set(&opts, "movflags", "faststart", 0);
+    ret = avformat_write_header(oc, &opts);
+    av_dict_free(&opts);
+    if (ret < 0) {
+        SET_ERROR(s, "Failed to write replay header: %s", av_err2str(ret));
+        ret = RTMP_ERROR_INIT_FAILED;
+        goto done;
+    }
+    
+    // Shift the clip to start at zero; audio from just before the keyframe is dropped
+    for (int i = 0; i < count; i++) {
+        AVPacket* pkt = packets[i];
+        int index = pkt->stream_index;
+        int64_t offset = av_rescale_q(start_us, (AVRational){1, AV_TIME_BASE}, time_base[index]);
+        if (pkt->dts != AV_NOPTS_VALUE) {
+            pkt->dts -= offset;
+        }
+        if (pkt->pts != AV_NOPTS_VALUE) {
+            pkt->pts -= offset;
+        }
+        if ((pkt->dts != AV_NOPTS_VALUE ? pkt->dts : pkt->pts) < 0 && index != video_index) {
+            continue;
+        }
+        av_packet_rescale_ts(pkt, time_base[index], oc->streams[index]->time_base);
+        
+        ret = av_interleaved_write_frame(oc, pkt);
+        if (ret < 0) {
+            SET_ERROR(s, "Failed to write replay: %s", av_err2str(ret));
+            ret = RTMP_ERROR_SEND_FAILED;
+            goto done;
+        }
+    }
+    
+    ret = av_write_trailer(oc) < 0 ? RTMP_ERROR_SEND_FAILED : RTMP_SUCCESS;
+    if (ret != RTMP_SUCCESS) {
+        SET_ERROR(s, "Failed to finish replay file %s", path);
+    }
+    
+done:
+    if (oc) {
+        if (!(oc->oformat->flags & AVFMT_NOFILE) && oc->pb) {
+            avio_closep(&oc->pb);
+        }
+        avformat_free_context(oc);
+    }
+    for (int i = 0; i < count; i++) {
+        av_packet_free(&packets[i]);
+    }
+    av_free(packets);
+    return ret;
+}
+
+RTMP_API int rtmp_session_get_recording_stats(RTMPSession* s, RTMPStats* stats) {
+    if (s == NULL || stats == NULL) {
+        return RTMP_ERROR_INVALID_PARAMS;
+    }
+    
+    Output* o = &s->recording;
+    memset(stats, 0, sizeof(*stats));
+    stats->bytes_sent = ATOMIC_LOAD64(&o->bytes_sent);
+    stats->dropped_frames = ATOMIC_LOAD(&o->queue.dropped_video);
+    stats->drop_policy = s->config.drop_policy;
+    stats->send_queue_depth = ATOMIC_LOAD(&o->queue.count);
+    stats->send_queue_capacity = o->queue.capacity;
+    stats->send_queue_high_water = ATOMIC_LOAD(&o->queue.high_water);
+    stats->send_queue_dropped_packets = ATOMIC_LOAD(&o->queue.dropped_packets);
+    return RTMP_SUCCESS;
+}
+
+RTMP_API int rtmp_session_get_recording_state(RTMPSession* s) {
+    if (s == NULL) {
+        return RTMP_STATE_ERROR;
+    }
+    return ATOMIC_LOAD(&s->recording.state);
+}
+
+RTMP_API int rtmp_session_get_destination_state(RTMPSession* s, int index) {
+    if (s == NULL || index < 0 || index >= s->destination_count) {
+        return RTMP_STATE_ERROR;
+    }
+    
+    // Destinations follow the main stream unless they failed
+    int state = ATOMIC_LOAD(&s->destinations[index].state);
+    return state == RTMP_STATE_CONNECTED ? s->state : state;
+}
+
+RTMP_API int rtmp_session_get_destination_stats(RTMPSession* s, int index, RTMPStats* stats) {
+    if (s == NULL || stats == NULL || index < 0 || index >= s->destination_count) {
+        return RTMP_ERROR_INVALID_PARAMS;
+    }
+    
+    // Only the network side applies; encoder stats are the main stream's
+    Output* o = &s->destinations[index];
+    memset(stats, 0, sizeof(*stats));
+    stats->bytes_sent = ATOMIC_LOAD64(&o->bytes_sent);
+    stats->dropped_frames = ATOMIC_LOAD(&o->queue.dropped_video);
+    stats->drop_policy = s->config.drop_policy;
+    stats->send_queue_depth = ATOMIC_LOAD(&o->queue.count);
+    stats->send_queue_capacity = o->queue.capacity;
+    stats->send_queue_high_water = ATOMIC_LOAD(&o->queue.high_water);
+    stats->send_queue_dropped_packets = ATOMIC_LOAD(&o->queue.dropped_packets);
+    return RTMP_SUCCESS;
+}
+
+RTMP_API int rtmp_session_get_rendition_stats(RTMPSession* s, int index, RTMPStats* stats) {
+    if (s == NULL || index < 0 || index >= s->rendition_count) {
+        return RTMP_ERROR_INVALID_PARAMS;
+    }
+    return rtmp_session_get_stats(s->renditions[index].session, stats);
+}
+
+RTMP_API int rtmp_session_set_encoder_option(RTMPSession* s, const char* key, const char* value) {
+    if (s == NULL || !s->mutex_initialized) {
+        return RTMP_ERROR_INVALID_PARAMS;
+    }
+    
+    if (key == NULL || key[0] == '\0') {
+        SET_ERROR(s, "Encoder option key is NULL or empty");
+        return RTMP_ERROR_INVALID_PARAMS;
+    }
+    
+    MUTEX_LOCK(s->mutex);
+    
+    if (s->state == RTMP_STATE_CONNECTING) {
+        // The connect thread copies the options outside the lock
+        SET_ERROR(s, "Cannot set encoder options while connecting");
+        MUTEX_UNLOCK(s->mutex);
+        return RTMP_ERROR_NOT_CONNECTED;
+    }
+    
+    // A NULL value removes the option again
+    int ret = av_dict_set(&s->encoder_options, key, value, 0);
+    MUTEX_UNLOCK(s->mutex);
+    
+    if (ret < 0) {
+        SET_ERROR(s, "Failed to store encoder option %s: %s", key, av_err2str(ret));
+        return RTMP_ERROR_ALLOC_FAILED;
+    }
+    return RTMP_SUCCESS;
+}
+
+RTMP_API int rtmp_session_probe_video_encoder(RTMPSession* s) {
+    if (s == NULL || !s->mutex_initialized) {
+        return RTMP_ERROR_INVALID_PARAMS;
+    }
+    
+    MUTEX_LOCK(s->mutex);
+    
+    if (s->state != RTMP_STATE_INITIALIZED) {
+        SET_ERROR(s, "Probe after rtmp_init and before rtmp_connect");
+        MUTEX_UNLOCK(s->mutex);
+        return RTMP_ERROR_NOT_CONNECTED;
+    }
+    
+    // Same selection as rtmp_connect (FLV wants global headers), then closed again
+    int ret = select_video_encoder(s, 1);
+    free_video_encoder(s);
+    
+    MUTEX_UNLOCK(s->mutex);
+    return ret;
+}
+
+RTMP_API const char* rtmp_session_get_video_encoder(RTMPSession* s) {
+    return s ? s->video_encoder : "";
+}
+
+RTMP_API const char* rtmp_session_get_encoder_probe(RTMPSession* s) {
+    return s ? s->encoder_probe : "";
+}
+
+RTMP_API int rtmp_session_stop_streaming(RTMPSession* s) {
+    if (s == NULL || !s->mutex_initialized) {
+        return RTMP_ERROR_INVALID_PARAMS;
+    }
+    
+    MUTEX_LOCK(s->mutex);
+    
+    if (s->state == RTMP_STATE_STREAMING) {
+        s->state = RTMP_STATE_CONNECTED;
+    }
+    
+    MUTEX_UNLOCK(s->mutex);
+    
+    stop_encoder_thread(s);
+    for (int i = 0; i < s->rendition_count; i++) {
+        rtmp_session_stop_streaming(s->renditions[i].session);
+    }
+    return RTMP_SUCCESS;
+}
+
+static int disconnect_session(RTMPSession* s) {
+    stop_encoder_thread(s);
+    
+    // Nothing feeds the renditions once the encoder thread has stopped
+    for (int i = 0; i < s->rendition_count; i++) {
+        rtmp_session_disconnect(s->renditions[i].session);
+    }
+    
+    MUTEX_LOCK(s->mutex);
+    
+    if (s->format_ctx) {
+        // Flush encoders
+        if (s->video_codec_ctx) {
+            avcodec_send_frame(s->video_codec_ctx, NULL);
+            while (avcodec_receive_packet(s->video_codec_ctx, s->packet) >= 0) {
+                av_packet_rescale_ts(s->packet, s->video_codec_ctx->time_base, s->video_stream->time_base);
+                s->packet->stream_index = s->video_stream->index;
+                send_packet(s, s->packet);
+            }
+        }
+        
+        // Let the sender drain what is queued before the trailer goes out
+        stop_sender_thread(s);
+        close_destinations(s);
+        stop_recording(s);
+        
+        // Write trailer and close the connection, unless reconnecting gave up
+        close_link(s, 1);
+    }
+    
+    packet_queue_destroy(&s->send_queue);
+    
+    // Clean up resources
+#ifdef RTMP_VERIFY_COLORCONV
+    if (s->sws_ctx) {
+        sws_freeContext(s->sws_ctx);
+        s->sws_ctx = NULL;
+    }
+    av_frame_free(&s->verify_frame);
+#endif
+    
+    if (s->swr_ctx) {
+        swr_free(&s->swr_ctx);
+    }
+    
+    free_video_encoder(s);
+    
+    if (s->audio_frame) {
+        av_frame_free(&s->audio_frame);
+    }
+    
+    if (s->audio_codec_ctx) {
+        avcodec_free_context(&s->audio_codec_ctx);
+    }
+    
+    if (s->format_ctx) {
+        avformat_free_context(s->format_ctx);
+        s->format_ctx = NULL;
+    }
+    
+    s->video_stream = NULL;
+    s->audio_stream = NULL;
+    s->state = RTMP_STATE_INITIALIZED;
+    
+    MUTEX_UNLOCK(s->mutex);
+    return RTMP_SUCCESS;
+}
+
+RTMP_API int rtmp_session_disconnect(RTMPSession* s) {
+    if (s == NULL || !s->mutex_initialized) {
+        return RTMP_SUCCESS;
+    }
+    
+    // An async connect still running is cancelled and finishes first
+    stop_connect_thread(s);
+    return disconnect_session(s);
+}
+
+RTMP_API void rtmp_session_cleanup(RTMPSession* s) {
+    if (s == NULL || !s->mutex_initialized) {
+        return;
+    }
+    
+    rtmp_session_disconnect(s);
+    
+    MUTEX_LOCK(s->mutex);
+    
+    free_renditions(s);
+    
+    if (s->packet) {
+        av_packet_free(&s->packet);
+    }
+    
+    if (s->sender_packet) {
+        av_packet_free(&s->sender_packet);
+    }
+    av_packet_free(&s->fanout_packet);
+    
+    MUTEX_LOCK(s->replay_mutex);
+    replay_free(s);
+    MUTEX_UNLOCK(s->replay_mutex);
+    
+    for (int i = 0; i < s->destination_count; i++) {
+        av_freep(&s->destinations[i].url);
+    }
+    s->destination_count = 0;
+    
+    // Disconnect stopped the encoder, so no buffer is still queued
+    frame_pool_free(s);
+    av_dict_free(&s->encoder_options);
+    
+    s->state = RTMP_STATE_IDLE;
+    
+    MUTEX_UNLOCK(s->mutex);
+}
+
+RTMP_API int rtmp_session_get_state(RTMPSession* s) {
+    if (s == NULL) {
+        return RTMP_STATE_ERROR;
+    }
+    if (ATOMIC_LOAD(&s->reconnecting) && (s->state == RTMP_STATE_CONNECTED || s->state == RTMP_STATE_STREAMING)) {
+        return RTMP_STATE_RECONNECTING;
+    }
+    return s->state;
+}
+
+RTMP_API const char* rtmp_session_get_error(RTMPSession* s) {
+    if (s == NULL) {
+        return "Invalid session";
+    }
+    return s->error_msg;
+}
+
+// Network side only; encoder overload is counted in skipped_frames
+static int session_dropped_frames(RTMPSession* s) {
+    return ATOMIC_LOAD(&s->send_queue.dropped_video);
+}
+
+RTMP_API int rtmp_session_get_stats(RTMPSession* s, RTMPStats* stats) {
+    if (s == NULL || stats == NULL) {
+        return RTMP_ERROR_INVALID_PARAMS;
+    }
+    
+    // Lock-free: counters are individually atomic, so a snapshot taken while
+    // streaming may mix values from neighbouring packets
+    memset(stats, 0, sizeof(*stats));
+    stats->bytes_sent = ATOMIC_LOAD64(&s->bytes_sent);
+    stats->frames_sent = ATOMIC_LOAD(&s->frames_sent);
+    stats->dropped_frames = session_dropped_frames(s);
+    stats->skipped_frames = ATOMIC_LOAD(&s->skipped_frames);
+    stats->avg_encode_us = ATOMIC_LOAD(&s->avg_encode_us);
+    stats->skip_policy = s->config.skip_policy;
+    stats->drop_policy = s->config.drop_policy;
+    stats->video_bitrate_kbps = s->config.bitrate_kbps;
+    stats->send_queue_depth = ATOMIC_LOAD(&s->send_queue.count);
+    stats->send_queue_capacity = s->send_queue.capacity;
+    stats->send_queue_high_water = ATOMIC_LOAD(&s->send_queue.high_water);
+    stats->send_queue_dropped_packets = ATOMIC_LOAD(&s->send_queue.dropped_packets);
+    stats->encoder_threads = s->encoder_threads;
+    stats->encoder_threading = s->encoder_threading;
+    stats->encoder_hardware = s->encoder_hardware;
+    stats->reconnects = ATOMIC_LOAD(&s->reconnects);
+    for (int i = 0; i < s->destination_count; i++) {
+        if (ATOMIC_LOAD(&s->destinations[i].state) == RTMP_STATE_ERROR) {
+            stats->destinations_failed++;
+        }
+    }
+    
+    return RTMP_SUCCESS;
+}
+
+// ==========================================
+// LEGACY API (default session)
+// ==========================================
+
+RTMP_API int rtmp_init_simple(
+    int width, 
+    int height, 
+    int fps, 
+    int bitrate_kbps,
+    int keyframe_interval,
+    int audio_sample_rate,
+    int audio_channels,
+    int audio_bitrate_kbps
+) {
+    RTMPConfig config = {0};
+    config.width = width;
+    config.height = height;
+    config.fps = fps;
+    config.bitrate_kbps = bitrate_kbps;
+    config.keyframe_interval = keyframe_interval;
+    config.audio_sample_rate = audio_sample_rate;
+    config.audio_channels = audio_channels;
+    config.audio_bitrate_kbps = audio_bitrate_kbps;
+    
+    return rtmp_init(&config);
+}
+
+RTMP_API int rtmp_init(const RTMPConfig* config) {
+    if (config == NULL) {
+        return rtmp_session_init(&g_default_session, NULL);
+    }
+    
+    // Callers of this entry point may pass the original, shorter struct
+    RTMPConfig full_config;
+    read_config(config, RTMP_CONFIG_BASE_SIZE, &full_config);
+    return rtmp_session_init(&g_default_session, &full_config);
+}
+
+RTMP_API int rtmp_init_ex(const RTMPConfig* config) {
+    return rtmp_session_init(&g_default_session, config);
+}
+
+RTMP_API int rtmp_connect(const char* url) {
+    return rtmp_session_connect(&g_default_session, url);
+}
+
+RTMP_API int rtmp_connect_async(const char* url) {
+    return rtmp_session_connect_async(&g_default_session, url);
+}
+
+RTMP_API int rtmp_start_streaming(void) {
+    return rtmp_session_start_streaming(&g_default_session);
+}
+
+RTMP_API int rtmp_send_video_frame(const uint8_t* rgba_data, int data_size, int64_t pts) {
+    return rtmp_session_send_video_frame(&g_default_session, rgba_data, data_size, pts);
+}
+
+RTMP_API int rtmp_submit_video_frame(
+    const uint8_t* data, int data_size,
+    RTMPReleaseCallback release, void* opaque,
+    int64_t pts
+) {
+    return rtmp_session_submit_video_frame(&g_default_session, data, data_size, release, opaque, pts);
+}
+
+RTMP_API uint8_t* rtmp_acquire_frame_buffer(int* size) {
+    return rtmp_session_acquire_frame_buffer(&g_default_session, size);
+}
+
+RTMP_API int rtmp_submit_frame_buffer(uint8_t* buffer, int64_t pts) {
+    return rtmp_session_submit_frame_buffer(&g_default_session, buffer, pts);
+}
+
+RTMP_API int rtmp_release_frame_buffer(uint8_t* buffer) {
+    return rtmp_session_release_frame_buffer(&g_default_session, buffer);
+}
+
+RTMP_API int rtmp_send_video_planes(
+    const uint8_t* plane0, int stride0,
+    const uint8_t* plane1, int stride1,
+    const uint8_t* plane2, int stride2,
+    int64_t pts
+) {
+    return rtmp_session_send_video_planes(&g_default_session, plane0, stride0, plane1, stride1, plane2, stride2, pts);
+}
+
+RTMP_API int rtmp_send_video_region(
+    const uint8_t* data, int stride,
+    int crop_x, int crop_y, int crop_width, int crop_height,
+    int64_t pts
+) {
+    return rtmp_session_send_video_region(&g_default_session, data, stride, crop_x, crop_y, crop_width, crop_height, pts);
+}
+
+RTMP_API int rtmp_send_audio(const float* pcm_data, int num_samples, int64_t pts) {
+    return rtmp_session_send_audio(&g_default_session, pcm_data, num_samples, pts);
+}
+
+RTMP_API int rtmp_set_video_bitrate(int bitrate_kbps) {
+    return rtmp_session_set_video_bitrate(&g_default_session, bitrate_kbps);
+}
+
+RTMP_API int rtmp_request_keyframe(void) {
+    return rtmp_session_request_keyframe(&g_default_session);
+}
+
+RTMP_API int rtmp_set_encoder_option(const char* key, const char* value) {
+    return rtmp_session_set_encoder_option(&g_default_session, key, value);
+}
+
+RTMP_API int rtmp_probe_video_encoder(void) {
+    return rtmp_session_probe_video_encoder(&g_default_session);
+}
+
+RTMP_API const char* rtmp_get_video_encoder(void) {
+    return rtmp_session_get_video_encoder(&g_default_session);
+}
+
+RTMP_API const char* rtmp_get_encoder_probe(void) {
+    return rtmp_session_get_encoder_probe(&g_default_session);
+}
+
+RTMP_API int rtmp_save_replay(const char* path, int seconds) {
+    return rtmp_session_save_replay(&g_default_session, path, seconds);
+}
+
+RTMP_API int rtmp_start_recording(const char* path) {
+    return rtmp_session_start_recording(&g_default_session, path);
+}
+
+RTMP_API int rtmp_stop_recording(void) {
+    return rtmp_session_stop_recording(&g_default_session);
+}
+
+RTMP_API int rtmp_get_recording_state(void) {
+    return rtmp_session_get_recording_state(&g_default_session);
+}
+
+RTMP_API int rtmp_get_recording_stats(RTMPStats* stats) {
+    return rtmp_session_get_recording_stats(&g_default_session, stats);
+}
+
+RTMP_API int rtmp_add_destination(const char* url) {
+    return rtmp_session_add_destination(&g_default_session, url);
+}
+
+RTMP_API int rtmp_get_destination_state(int index) {
+    return rtmp_session_get_destination_state(&g_default_session, index);
+}
+
+RTMP_API int rtmp_get_destination_stats(int index, RTMPStats* stats) {
+    return rtmp_session_get_destination_stats(&g_default_session, index, stats);
+}
+
+RTMP_API int rtmp_add_rendition(const char* url, int width, int height, int bitrate_kbps) {
+    return rtmp_session_add_rendition(&g_default_session, url, width, height, bitrate_kbps);
+}
+
+RTMP_API int rtmp_get_rendition_stats(int index, RTMPStats* stats) {
+    return rtmp_session_get_rendition_stats(&g_default_session, index, stats);
+}
+
+RTMP_API int rtmp_stop_streaming(void) {
+    return rtmp_session_stop_streaming(&g_default_session);
+}
+
+RTMP_API int rtmp_disconnect(void) {
+    return rtmp_session_disconnect(&g_default_session);
+}
+
+RTMP_API void rtmp_cleanup(void) {
+    rtmp_session_cleanup(&g_default_session);
+}
+
+RTMP_API int rtmp_get_state(void) {
+    return rtmp_session_get_state(&g_default_session);
+}
+
+RTMP_API const char* rtmp_get_error(void) {
+    return rtmp_session_get_error(&g_default_session);
+}
+
+RTMP_API int64_t rtmp_get_bytes_sent(void) {
+    return ATOMIC_LOAD64(&g_default_session.bytes_sent);
+}
+
+RTMP_API int rtmp_get_frames_sent(void) {
+    return ATOMIC_LOAD(&g_default_session.frames_sent);
+}
 
 RTMP_API int rtmp_get_dropped_frames(void) {
-    return g_rtmp.dropped_frames;
+    return session_dropped_frames(&g_default_session);
+}
+
+RTMP_API int rtmp_get_stats(RTMPStats* stats) {
+    return rtmp_session_get_stats(&g_default_session, stats);
 }
 
 RTMP_API int rtmp_is_stub(void) {
@@ -759,5 +4348,7 @@ RTMP_API int rtmp_is_stub(void) {
 }
 
 RTMP_API const char* rtmp_get_build_info(void) {
-    return "ffmpeg-bridge";
+    static char info[64];
+    snprintf(info, sizeof(info), "ffmpeg-bridge (colorconv: %s)", rtmp_colorconv_init());
+    return info;
 }
@@ -32,6 +32,39 @@ extern "C" {
 #define RTMP_ERROR_NOT_CONNECTED -5
 #define RTMP_ERROR_INVALID_PARAMS -6
 #define RTMP_ERROR_ALLOC_FAILED -7
+#define RTMP_ERROR_NOT_SUPPORTED -8
+
+// Send queue drop policies (what happens when the network falls behind)
+#define RTMP_DROP_NEWEST 0  // Drop incoming video, resume at the next keyframe
+#define RTMP_DROP_QUEUED 1  // Flush queued video to cut latency, resume at the next keyframe
+
+// Encoder overload policies (RTMPConfig.skip_policy), applied while the
+// average encode time exceeds the 1/fps frame budget
+#define RTMP_SKIP_DROP_NEWEST 0  // Skip incoming frames while one is already waiting
+#define RTMP_SKIP_DROP_OLDEST 1  // Skip the oldest waiting frame in favour of newer ones
+#define RTMP_SKIP_KEEP_LATEST 2  // Always encode only the newest waiting frame
+
+// Video rate control modes (RTMPConfig.rate_control)
+#define RTMP_RATE_CONTROL_ABR 0  // Average bitrate, short bursts above it are allowed
+#define RTMP_RATE_CONTROL_VBV 1  // Peak rate capped at bitrate_kbps through a vbv_buffer_ms buffer
+#define RTMP_RATE_CONTROL_CBR 2  // VBV plus filler data, constant output rate
+
+// Video encoder threading models (RTMPConfig.threading)
+#define RTMP_THREADING_SLICE 0  // Each frame split into slices across threads, no added latency
+#define RTMP_THREADING_FRAME 1  // Consecutive frames on different threads, one frame of delay per thread
+
+// Video codecs (RTMPConfig.video_codec). HEVC and AV1 are sent with
+// enhanced RTMP FourCC signalling and need an ingest that accepts it.
+#define RTMP_VIDEO_CODEC_H264 0  // libx264
+#define RTMP_VIDEO_CODEC_HEVC 1  // libx265
+#define RTMP_VIDEO_CODEC_AV1  2  // libsvtav1, else libaom-av1 (realtime presets)
+
+// Input pixel formats (RTMPConfig.pixel_format)
+#define RTMP_PIXEL_FORMAT_RGBA 0  // Packed R,G,B,A bytes
+#define RTMP_PIXEL_FORMAT_BGRA 1  // Packed B,G,R,A bytes (D3D11/Metal native order)
+#define RTMP_PIXEL_FORMAT_ARGB 2  // Packed A,R,G,B bytes
+#define RTMP_PIXEL_FORMAT_NV12 3  // Y plane + interleaved UV plane, passed to the encoder as is
+#define RTMP_PIXEL_FORMAT_I420 4  // Y, U and V planes, passed to the encoder as is
 
 // Stream state
 typedef enum {
@@ -39,10 +72,15 @@ typedef enum {
     RTMP_STATE_INITIALIZED = 1,
     RTMP_STATE_CONNECTED = 2,
     RTMP_STATE_STREAMING = 3,
+    RTMP_STATE_RECONNECTING = 4,   // link lost, retrying; send calls keep working
+    RTMP_STATE_CONNECTING = 5,     // connect in progress (see rtmp_connect_async)
     RTMP_STATE_ERROR = -1
 } RTMPState;
 
-// Configuration structure
+// Configuration structure. The fields after audio_bitrate_kbps were added
+// later; struct_size says how many of them the caller's struct has, and any
+// it lacks take their defaults, so callers built against an older header
+// keep working (see rtmp_init_ex).
 typedef struct {
     int width;
     int height;
@@ -52,17 +90,156 @@ typedef struct {
     int audio_sample_rate;
     int audio_channels;
     int audio_bitrate_kbps;
+    int struct_size;        // sizeof(RTMPConfig); 0 = only the fields above
+    int async_encode;       // 1 = encode on a background thread, send calls only enqueue
+    int send_queue_size;    // encoded packets buffered for the network thread (0 = default)
+    int drop_policy;        // RTMP_DROP_* applied when the send queue is full
+    int flip_vertical;      // 1 = input rows are bottom-up (e.g. GPU readback), flipped during conversion
+    int pixel_format;       // RTMP_PIXEL_FORMAT_* of submitted frames
+    int adaptive_bitrate;   // 1 = lower/raise video bitrate with network congestion (libx264/NVENC only)
+    int min_bitrate_kbps;   // adaptive bitrate floor (0 = bitrate_kbps / 4)
+    int skip_policy;        // RTMP_SKIP_* applied when encoding falls behind fps
+    int rate_control;       // RTMP_RATE_CONTROL_* for video
+    int vbv_buffer_ms;      // VBV buffer for VBV/CBR in ms at bitrate_kbps (0 = 1000)
+    int encoder_threads;    // video encoder threads (0 = one per core, up to 8)
+    int threading;          // RTMP_THREADING_* for the video encoder
+    int video_codec;        // RTMP_VIDEO_CODEC_*
+    int hardware_encode;    // 1 = try hardware encoders first, fall back to software
+    int replay_buffer_seconds; // keep this much recent encoded stream for rtmp_save_replay (0 = off)
+    int reconnect_attempts; // reconnects tried per outage, with backoff, before giving up (0 = off)
 } RTMPConfig;
 
+// Statistics snapshot
+typedef struct {
+    int64_t bytes_sent;
+    int frames_sent;
+    int dropped_frames;             // video frames lost to network backpressure
+    int send_queue_depth;           // packets waiting for the network thread
+    int send_queue_capacity;
+    int send_queue_high_water;      // deepest the send queue has been this connection
+    int send_queue_dropped_packets; // audio + video packets dropped by the send queue
+    int drop_policy;
+    int video_bitrate_kbps;         // current video bitrate target
+    int skipped_frames;             // video frames shed because the encoder is behind
+    int avg_encode_us;              // recent average time to encode one frame
+    int skip_policy;
+    int encoder_threads;            // threads the video encoder was opened with (0 before connecting)
+    int encoder_threading;          // RTMP_THREADING_* in use
+    int encoder_hardware;           // 1 = a hardware encoder was chosen
+    int reconnects;                 // successful automatic reconnects this connection
+    int destinations_failed;        // rtmp_add_destination outputs that failed to open or dropped out
+} RTMPStats;
+
+// Called once the bridge no longer needs a frame passed to
+// rtmp_submit_video_frame. May run on the encoder thread.
+typedef void (*RTMPReleaseCallback)(void* opaque, const uint8_t* data);
+
+// Opaque streaming session. Each session owns its own encoders, connection
+// and threads, so several sessions can stream in parallel from one process.
+typedef struct RTMPSession RTMPSession;
+
+// ==========================================
+// SESSION API
+// ==========================================
+
+/**
+ * Create a new session. Release it with rtmp_session_destroy().
+ * 
+ * @return Session handle, or NULL on allocation failure
+ */
+RTMP_API RTMPSession* rtmp_session_create(void);
+
+/**
+ * Disconnect, clean up and free a session created by rtmp_session_create().
+ */
+RTMP_API void rtmp_session_destroy(RTMPSession* session);
+
+/**
+ * Session variants of the functions below. Each behaves exactly like its
+ * rtmp_* counterpart but operates on the given session only.
+ */
+RTMP_API int rtmp_session_init(RTMPSession* session, const RTMPConfig* config);  // reads struct_size like rtmp_init_ex
+RTMP_API int rtmp_session_connect(RTMPSession* session, const char* url);
+RTMP_API int rtmp_session_connect_async(RTMPSession* session, const char* url);
+RTMP_API int rtmp_session_start_streaming(RTMPSession* session);
+RTMP_API int rtmp_session_send_video_frame(RTMPSession* session, const uint8_t* rgba_data, int data_size, int64_t pts);
+RTMP_API int rtmp_session_submit_video_frame(
+    RTMPSession* session,
+    const uint8_t* data, int data_size,
+    RTMPReleaseCallback release, void* opaque,
+    int64_t pts
+);
+RTMP_API uint8_t* rtmp_session_acquire_frame_buffer(RTMPSession* session, int* size);
+RTMP_API int rtmp_session_submit_frame_buffer(RTMPSession* session, uint8_t* buffer, int64_t pts);
+RTMP_API int rtmp_session_release_frame_buffer(RTMPSession* session, uint8_t* buffer);
+RTMP_API int rtmp_session_send_video_planes(
+    RTMPSession* session,
+    const uint8_t* plane0, int stride0,
+    const uint8_t* plane1, int stride1,
+    const uint8_t* plane2, int stride2,
+    int64_t pts
+);
+RTMP_API int rtmp_session_send_video_region(
+    RTMPSession* session,
+    const uint8_t* data, int stride,
+    int crop_x, int crop_y, int crop_width, int crop_height,
+    int64_t pts
+);
+RTMP_API int rtmp_session_send_audio(RTMPSession* session, const float* pcm_data, int num_samples, int64_t pts);
+RTMP_API int rtmp_session_set_video_bitrate(RTMPSession* session, int bitrate_kbps);
+RTMP_API int rtmp_session_request_keyframe(RTMPSession* session);
+RTMP_API int rtmp_session_set_encoder_option(RTMPSession* session, const char* key, const char* value);
+RTMP_API int rtmp_session_probe_video_encoder(RTMPSession* session);
+RTMP_API const char* rtmp_session_get_video_encoder(RTMPSession* session);
+RTMP_API const char* rtmp_session_get_encoder_probe(RTMPSession* session);
+RTMP_API int rtmp_session_save_replay(RTMPSession* session, const char* path, int seconds);
+RTMP_API int rtmp_session_start_recording(RTMPSession* session, const char* path);
+RTMP_API int rtmp_session_stop_recording(RTMPSession* session);
+RTMP_API int rtmp_session_get_recording_state(RTMPSession* session);
+RTMP_API int rtmp_session_get_recording_stats(RTMPSession* session, RTMPStats* stats);
+RTMP_API int rtmp_session_add_destination(RTMPSession* session, const char* url);
+RTMP_API int rtmp_session_get_destination_state(RTMPSession* session, int index);
+RTMP_API int rtmp_session_get_destination_stats(RTMPSession* session, int index, RTMPStats* stats);
+RTMP_API int rtmp_session_add_rendition(RTMPSession* session, const char* url, int width, int height, int bitrate_kbps);
+RTMP_API int rtmp_session_get_rendition_stats(RTMPSession* session, int index, RTMPStats* stats);
+RTMP_API int rtmp_session_stop_streaming(RTMPSession* session);
+RTMP_API int rtmp_session_disconnect(RTMPSession* session);
+RTMP_API void rtmp_session_cleanup(RTMPSession* session);
+RTMP_API int rtmp_session_get_state(RTMPSession* session);
+RTMP_API const char* rtmp_session_get_error(RTMPSession* session);
+RTMP_API int rtmp_session_get_stats(RTMPSession* session, RTMPStats* stats);
+
+// ==========================================
+// DEFAULT SESSION API
+// The functions below operate on a built-in default session.
+// ==========================================
+
 /**
  * Initialize the RTMP encoder with the given configuration.
  * Must be called before connect().
  * 
+ * Only reads the fields up to audio_bitrate_kbps, the layout this function
+ * has always taken; everything else gets its default. Use rtmp_init_ex for
+ * the other settings.
+ * 
  * @param config Pointer to configuration structure
  * @return RTMP_SUCCESS or error code
  */
 RTMP_API int rtmp_init(const RTMPConfig* config);
 
+/**
+ * Initialize with the full configuration structure.
+ * 
+ * Set config->struct_size to sizeof(RTMPConfig). Fields beyond struct_size
+ * are not read and take their defaults, so a caller compiled against an
+ * older header stays compatible with a newer library. struct_size 0 reads
+ * the same fields as rtmp_init.
+ * 
+ * @param config Pointer to configuration structure
+ * @return RTMP_SUCCESS or error code
+ */
+RTMP_API int rtmp_init_ex(const RTMPConfig* config);
+
 /**
  * Simplified init with individual parameters (for easier P/Invoke)
  */
@@ -80,24 +257,159 @@ RTMP_API int rtmp_init_simple(
 /**
  * Connect to an RTMP/RTMPS server.
  * 
+ * The network handshake runs on a helper thread while the encoders open,
+ * so this takes the longer of the two rather than their sum.
+ * 
  * @param url Full RTMP URL including stream key
  * @return RTMP_SUCCESS or error code
  */
 RTMP_API int rtmp_connect(const char* url);
 
+/**
+ * Connect in the background and return immediately.
+ * 
+ * rtmp_get_state reports RTMP_STATE_CONNECTING until the connect ends, then
+ * RTMP_STATE_CONNECTED, or RTMP_STATE_ERROR with rtmp_get_error set. After
+ * an error, rtmp_connect_async can be called again. rtmp_disconnect cancels
+ * a connect in progress, interrupting the main, destination and rendition
+ * handshakes, and waits for it to wind down. Other calls fail with
+ * RTMP_ERROR_NOT_CONNECTED until the connect ends. The connect never holds
+ * the session lock across a network step, so they do not wait on the
+ * network either.
+ * 
+ * @param url Full RTMP URL including stream key
+ * @return RTMP_SUCCESS if the connect started, or error code
+ */
+RTMP_API int rtmp_connect_async(const char* url);
+
 /**
  * Send a video frame.
  * 
- * @param rgba_data Pointer to RGBA pixel data (width * height * 4 bytes)
+ * Encoded packets are handed to a network thread through a bounded queue, so
+ * a congested connection never blocks the encoder. Send failures on that
+ * thread are reported by the next send call.
+ * 
+ * With async_encode enabled the frame is copied into a lock-free ring and
+ * encoded on a background thread; the call returns without waiting for the
+ * encoder. Must be called from one thread at a time (single producer).
+ * If the encoder falls behind, frames are skipped according to skip_policy
+ * and counted in skipped frames.
+ * Errors from the background encoder are reported by the next call.
+ * 
+ * @param rgba_data Tightly packed pixels in the configured pixel_format
+ *                  (width * height * 4 bytes for RGBA/BGRA/ARGB, planes
+ *                  back to back for NV12/I420)
  * @param data_size Size of the data in bytes
  * @param pts Presentation timestamp in milliseconds
  * @return RTMP_SUCCESS or error code
  */
 RTMP_API int rtmp_send_video_frame(const uint8_t* rgba_data, int data_size, int64_t pts);
 
+/**
+ * Send a video frame without copying it.
+ * 
+ * Same layout and queuing behavior as rtmp_send_video_frame, but with
+ * async_encode the bridge keeps a reference to data instead of copying it
+ * into the encode ring. The caller must leave the buffer untouched until
+ * release(opaque, data) is called. release is called exactly once for every
+ * call, including when the frame is rejected or dropped; without
+ * async_encode it is called before this function returns.
+ * 
+ * @param data Tightly packed pixels in the configured pixel_format
+ * @param data_size Size of the data in bytes
+ * @param release Callback invoked when the buffer is no longer used
+ *                (NULL behaves like rtmp_send_video_frame)
+ * @param opaque Passed back to release
+ * @param pts Presentation timestamp in milliseconds
+ * @return RTMP_SUCCESS or error code
+ */
+RTMP_API int rtmp_submit_video_frame(
+    const uint8_t* data, int data_size,
+    RTMPReleaseCallback release, void* opaque,
+    int64_t pts
+);
+
+/**
+ * Borrow a frame buffer from the bridge's pool so it can be filled in place,
+ * e.g. as the target of a GPU readback. Buffers are 64-byte aligned and hold
+ * one tightly packed frame in the configured pixel_format. The pool is
+ * allocated by the first call after rtmp_init and freed by rtmp_cleanup.
+ * 
+ * @param size Receives the buffer size in bytes (may be NULL)
+ * @return Buffer, or NULL if every buffer is lent out or queued for encoding
+ */
+RTMP_API uint8_t* rtmp_acquire_frame_buffer(int* size);
+
+/**
+ * Send a buffer from rtmp_acquire_frame_buffer without copying it. The
+ * buffer goes back to the pool once the encoder has converted it; the
+ * caller must not touch it after this call, whatever the result.
+ * 
+ * @param buffer Buffer returned by rtmp_acquire_frame_buffer
+ * @param pts Presentation timestamp in milliseconds
+ * @return RTMP_SUCCESS or error code
+ */
+RTMP_API int rtmp_submit_frame_buffer(uint8_t* buffer, int64_t pts);
+
+/**
+ * Return a buffer from rtmp_acquire_frame_buffer without sending it
+ * (e.g. when the readback failed).
+ * 
+ * @return RTMP_SUCCESS or error code
+ */
+RTMP_API int rtmp_release_frame_buffer(uint8_t* buffer);
+
+/**
+ * Send a video frame given as separate planes with their own row strides.
+ * Same queuing behavior as rtmp_send_video_frame.
+ * 
+ * - RGBA/BGRA/ARGB: plane0 holds the pixels; plane1/plane2 are ignored
+ * - NV12: plane0 = Y, plane1 = interleaved UV; plane2 is ignored
+ * - I420: plane0 = Y, plane1 = U, plane2 = V
+ * 
+ * Chroma planes are half width and half height, rounded up.
+ * 
+ * @param plane0, plane1, plane2 Plane pointers
+ * @param stride0, stride1, stride2 Bytes between rows of each plane
+ * @param pts Presentation timestamp in milliseconds
+ * @return RTMP_SUCCESS or error code
+ */
+RTMP_API int rtmp_send_video_planes(
+    const uint8_t* plane0, int stride0,
+    const uint8_t* plane1, int stride1,
+    const uint8_t* plane2, int stride2,
+    int64_t pts
+);
+
+/**
+ * Send a region of a larger packed (RGBA/BGRA/ARGB) image, e.g. a padded
+ * GPU readback buffer or a letterboxed area, without repacking it first.
+ * Same queuing behavior as rtmp_send_video_frame.
+ * 
+ * The region is not scaled, so crop_width/crop_height must equal the
+ * configured width/height.
+ * 
+ * @param data First row of the source image
+ * @param stride Bytes between source rows (at least (crop_x + crop_width) * 4)
+ * @param crop_x, crop_y Top-left corner of the region in pixels
+ * @param crop_width, crop_height Size of the region in pixels
+ * @param pts Presentation timestamp in milliseconds
+ * @return RTMP_SUCCESS or error code
+ */
+RTMP_API int rtmp_send_video_region(
+    const uint8_t* data, int stride,
+    int crop_x, int crop_y, int crop_width, int crop_height,
+    int64_t pts
+);
+
 /**
  * Send audio samples.
  * 
+ * With async_encode enabled the samples are copied into a lock-free ring and
+ * encoded on the encoder thread, so the audio thread never waits on video.
+ * It may run on another thread than rtmp_stop_streaming/rtmp_disconnect,
+ * which wait for a call in progress before releasing the ring.
+ * 
  * @param pcm_data Pointer to PCM audio data (float samples, interleaved)
  * @param num_samples Number of samples per channel
  * @param pts Presentation timestamp in milliseconds
@@ -105,6 +417,214 @@ RTMP_API int rtmp_send_video_frame(const uint8_t* rgba_data, int data_size, int6
  */
 RTMP_API int rtmp_send_audio(const float* pcm_data, int num_samples, int64_t pts);
 
+/**
+ * Change the video bitrate without reconnecting.
+ * 
+ * While streaming, the new target is applied to the running encoder just
+ * before the next frame, with no extra keyframe. Before connecting it
+ * replaces the configured bitrate_kbps. With adaptive_bitrate it also
+ * becomes the ceiling the controller ramps back up to.
+ * 
+ * Only libx264 and NVENC follow a new bitrate once opened. With any other
+ * encoder connected this fails with RTMP_ERROR_NOT_SUPPORTED and the
+ * bitrate is left unchanged; set it before rtmp_connect instead.
+ * While an async connect is in progress it fails with
+ * RTMP_ERROR_NOT_CONNECTED.
+ * 
+ * @param bitrate_kbps New video bitrate in kbps
+ * @return RTMP_SUCCESS or error code
+ */
+RTMP_API int rtmp_set_video_bitrate(int bitrate_kbps);
+
+/**
+ * Force the next encoded video frame to be an IDR keyframe.
+ * 
+ * Useful when a viewer joins or a highlight clip should start on the
+ * current frame instead of waiting for the next scheduled keyframe.
+ * Several requests before the next frame collapse into one keyframe.
+ * 
+ * @return RTMP_SUCCESS or error code
+ */
+RTMP_API int rtmp_request_keyframe(void);
+
+/**
+ * Set a video encoder option (call after init, before connect)
+ * 
+ * Options are passed to the encoder as-is when rtmp_connect opens it and
+ * override the built-in low latency defaults (preset=veryfast,
+ * tune=zerolatency, profile=main). Both generic codec options and
+ * libx264 private options are accepted, for example:
+ * 
+ *   preset=faster, profile=high, threads=4, slices=4, rc-lookahead=0,
+ *   maxrate=4000000, bufsize=2000000 (bits), crf=23, nal-hrd=cbr,
+ *   x264-params=keyint=60:scenecut=0
+ * 
+ * An option the encoder does not know makes rtmp_connect fail. Options
+ * stay set until changed or removed, or until rtmp_cleanup.
+ * While an async connect is in progress it fails with
+ * RTMP_ERROR_NOT_CONNECTED.
+ * 
+ * @param key Option name
+ * @param value Option value, or NULL to remove the option
+ * @return RTMP_SUCCESS or error code
+ */
+RTMP_API int rtmp_set_encoder_option(const char* key, const char* value);
+
+/**
+ * Run video encoder selection without connecting (call after init)
+ * 
+ * Opens and closes encoders in the same order rtmp_connect would: with
+ * hardware_encode, NVENC, VAAPI, MediaCodec and VideoToolbox first, then
+ * the software encoder. Encoders missing from this FFmpeg build, or whose
+ * device or driver is absent, are skipped. Encoder options apply, so an
+ * option a hardware encoder does not know also moves on to the next one.
+ * 
+ * @return RTMP_SUCCESS if any encoder opened, otherwise the last error
+ */
+RTMP_API int rtmp_probe_video_encoder(void);
+
+/**
+ * Get the video encoder chosen by the last connect or probe
+ * 
+ * @return Encoder name (e.g. "h264_nvenc", "libx264"), empty if none
+ */
+RTMP_API const char* rtmp_get_video_encoder(void);
+
+/**
+ * Get every encoder the last connect or probe tried, in order, and why
+ * each one was skipped, e.g.
+ * "h264_nvenc: not built; h264_vaapi: No vaapi device: ...; libx264: ok"
+ * 
+ * @return Probe log, empty before the first connect or probe
+ */
+RTMP_API const char* rtmp_get_encoder_probe(void);
+
+/**
+ * Save the last seconds of the stream to a file (needs
+ * config.replay_buffer_seconds)
+ * 
+ * Remuxes the buffered packets without re-encoding, starting at the last
+ * keyframe at least `seconds` before the newest packet, or at the oldest
+ * one if less is buffered. The container follows the extension (.mp4,
+ * .mkv, ...). Works while streaming and after disconnect, until the next
+ * connect. Writes the file before returning, so call it off the main
+ * thread for long clips.
+ * 
+ * @param path Output file path
+ * @param seconds Clip length, up to replay_buffer_seconds
+ * @return RTMP_SUCCESS or error code
+ */
+RTMP_API int rtmp_save_replay(const char* path, int seconds);
+
+/**
+ * Start recording the stream to a local file (call after connect)
+ * 
+ * The file gets the same encoded packets as the network, so recording
+ * costs no extra encoding. The container follows the extension: .mp4
+ * (fragmented, so it stays playable if the app dies), .mkv or .flv. A
+ * writer thread with its own queue does the file I/O and never holds up
+ * the stream. The file starts at a keyframe, which is requested now.
+ * 
+ * Recording stops at rtmp_stop_recording or rtmp_disconnect.
+ * 
+ * @param path Output file path
+ * @return RTMP_SUCCESS or error code
+ */
+RTMP_API int rtmp_start_recording(const char* path);
+
+/**
+ * Stop recording: writes out queued packets and finishes the file.
+ * Also closes a recording that failed.
+ * 
+ * @return RTMP_SUCCESS or error code
+ */
+RTMP_API int rtmp_stop_recording(void);
+
+/**
+ * Get the recording state
+ * 
+ * @return RTMP_STATE_IDLE when not recording, RTMP_STATE_CONNECTED while
+ *         recording, RTMP_STATE_ERROR once a write failed
+ */
+RTMP_API int rtmp_get_recording_state(void);
+
+/**
+ * Get recording statistics (bytes written, queue and drops)
+ * 
+ * @param stats Output statistics; encoder fields are left zero
+ * @return RTMP_SUCCESS or error code
+ */
+RTMP_API int rtmp_get_recording_stats(RTMPStats* stats);
+
+/**
+ * Add a fan-out destination (call after init, before connect)
+ * 
+ * The main stream's encoded packets are also sent to this URL, without
+ * encoding again. Each destination has its own send queue and thread, so
+ * a slow or broken destination only drops its own packets and never holds
+ * back the main stream or the other destinations.
+ * 
+ * Destinations open during rtmp_connect. One that fails to open, or later
+ * fails to write, goes to RTMP_STATE_ERROR on its own while the main stream
+ * carries on; rtmp_get_stats counts these in destinations_failed. A stalled
+ * destination delays disconnect by at most 2 seconds.
+ * Up to 4 destinations; they stay added until rtmp_cleanup.
+ * 
+ * @param url RTMP URL
+ * @return RTMP_SUCCESS or error code
+ */
+RTMP_API int rtmp_add_destination(const char* url);
+
+/**
+ * Get a destination's state, in the order they were added
+ * 
+ * @param index Destination index
+ * @return The main stream's state while the destination is healthy,
+ *         RTMP_STATE_ERROR once it failed
+ */
+RTMP_API int rtmp_get_destination_state(int index);
+
+/**
+ * Get a destination's network statistics (bytes sent, queue and drops)
+ * 
+ * @param index Destination index
+ * @param stats Output statistics; encoder fields are left zero
+ * @return RTMP_SUCCESS or error code
+ */
+RTMP_API int rtmp_get_destination_stats(int index, RTMPStats* stats);
+
+/**
+ * Add a simulcast rendition (call after init, before connect)
+ * 
+ * The rendition is a second output at a lower resolution and bitrate,
+ * with its own encoder and encode thread, published to its own URL. It
+ * uses the main stream's settings and encoder options otherwise. Frames
+ * are colour converted once for all outputs; each rendition scales the
+ * converted frame down on its own encode thread, in parallel with the
+ * main encode. A rendition that falls behind skips frames on its own.
+ * 
+ * Connect, start, stop, disconnect, audio and keyframe requests apply to
+ * every rendition. Renditions connect in parallel, each on its own thread;
+ * if one fails, the others are cancelled and rtmp_connect fails.
+ * Up to 4 renditions; they stay added until rtmp_cleanup.
+ * 
+ * @param url RTMP URL for this rendition
+ * @param width Width, at most the main stream's (rounded down to even)
+ * @param height Height, at most the main stream's (rounded down to even)
+ * @param bitrate_kbps Video bitrate
+ * @return RTMP_SUCCESS or error code
+ */
+RTMP_API int rtmp_add_rendition(const char* url, int width, int height, int bitrate_kbps);
+
+/**
+ * Get statistics for a rendition, in the order they were added
+ * 
+ * @param index Rendition index
+ * @param stats Output statistics
+ * @return RTMP_SUCCESS or error code
+ */
+RTMP_API int rtmp_get_rendition_stats(int index, RTMPStats* stats);
+
 /**
  * Start streaming (call after connect, before sending frames)
  * 
@@ -135,6 +655,13 @@ RTMP_API void rtmp_cleanup(void);
 /**
  * Get current state.
  * 
+ * With config.reconnect_attempts set, a lost connection reports
+ * RTMP_STATE_RECONNECTING while it is re-opened in the background, with
+ * a backoff from 0.5s doubling up to 8s. Frames are still accepted and
+ * buffered in the send queue, which drops on overflow. The stream resumes
+ * at the next keyframe. Once the attempts run out, send calls return
+ * RTMP_ERROR_SEND_FAILED.
+ * 
  * @return Current RTMPState
  */
 RTMP_API int rtmp_get_state(void);
@@ -153,6 +680,14 @@ RTMP_API int64_t rtmp_get_bytes_sent(void);
 RTMP_API int rtmp_get_frames_sent(void);
 RTMP_API int rtmp_get_dropped_frames(void);
 
+/**
+ * Fill a statistics snapshot, including send queue depth and drops.
+ * 
+ * @param stats Structure to fill
+ * @return RTMP_SUCCESS or error code
+ */
+RTMP_API int rtmp_get_stats(RTMPStats* stats);
+
 /**
  * Identify whether this build is the stub implementation.
  * Returns 1 for stub, 0 for real implementation.
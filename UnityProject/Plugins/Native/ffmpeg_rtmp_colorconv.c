@@ -0,0 +1,617 @@
+/**
+ * FFmpeg RTMP Bridge - Colour Conversion
+ *
+ * Packed 32-bit RGB -> I420 kernels. Every path uses the same 8-bit fixed
+ * point BT.601 (limited range) formulas as the scalar reference, so output
+ * is bit-identical regardless of which kernel the CPU selects:
+ *
+ *   Y = ((  66 R + 129 G +  25 B + 128) >> 8) + 16
+ *   U = (( -38 R -  74 G + 112 B + 128) >> 8) + 128
+ *   V = (( 112 R -  94 G -  18 B + 128) >> 8) + 128
+ *
+ * U and V are computed from the rounded average of each 2x2 pixel block.
+ * All intermediates fit in 16 bits, which is what the SIMD paths rely on.
+ */
+
+#include "ffmpeg_rtmp_colorconv.h"
+#include <stddef.h>
+#include <string.h>
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__SSE2__) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define COLORCONV_X86 1
+#include <emmintrin.h>
+#include <immintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+#endif
+
+#if defined(__ARM_NEON) || defined(__ARM_NEON__) || defined(_M_ARM64)
+#define COLORCONV_NEON 1
+#include <arm_neon.h>
+#endif
+
+#if defined(__GNUC__) || defined(__clang__)
+#define TARGET_AVX2 __attribute__((target("avx2")))
+#else
+#define TARGET_AVX2
+#endif
+
+// Byte offsets of R, G and B within a 4-byte pixel
+typedef struct {
+    int r;
+    int g;
+    int b;
+} ChannelOffsets;
+
+static const ChannelOffsets RGBA_OFFSETS = { 0, 1, 2 };
+static const ChannelOffsets BGRA_OFFSETS = { 2, 1, 0 };
+static const ChannelOffsets ARGB_OFFSETS = { 1, 2, 3 };
+
+typedef void (*ConvertFunc)(
+    const uint8_t* src, int src_stride,
+    uint8_t* dst_y, int y_stride,
+    uint8_t* dst_u, int u_stride,
+    uint8_t* dst_v, int v_stride,
+    int width, int height,
+    const ChannelOffsets* ch
+);
+
+// ==========================================
+// SCALAR REFERENCE
+// ==========================================
+
+static inline uint8_t rgb_to_y(int r, int g, int b) {
+    return (uint8_t)(((66 * r + 129 * g + 25 * b + 128) >> 8) + 16);
+}
+
+static inline uint8_t rgb_to_u(int r, int g, int b) {
+    return (uint8_t)(((-38 * r - 74 * g + 112 * b + 128) >> 8) + 128);
+}
+
+static inline uint8_t rgb_to_v(int r, int g, int b) {
+    return (uint8_t)(((112 * r - 94 * g - 18 * b + 128) >> 8) + 128);
+}
+
+// Converts pixels [x, width) of a row pair. row1/y1 may repeat row0/NULL for
+// the last row of an odd-height image; an odd last column is duplicated.
+static void convert_row_pair_scalar(
+    const uint8_t* row0, const uint8_t* row1,
+    uint8_t* y0, uint8_t* y1, uint8_t* u, uint8_t* v,
+    int x, int width, const ChannelOffsets* ch
+) {
+    for (; x < width; x += 2) {
+        int has_right = x + 1 < width;
+        const uint8_t* p00 = row0 + x * 4;
+        const uint8_t* p01 = has_right ? p00 + 4 : p00;
+        const uint8_t* p10 = row1 + x * 4;
+        const uint8_t* p11 = has_right ? p10 + 4 : p10;
+
+        y0[x] = rgb_to_y(p00[ch->r], p00[ch->g], p00[ch->b]);
+        if (has_right) {
+            y0[x + 1] = rgb_to_y(p01[ch->r], p01[ch->g], p01[ch->b]);
+        }
+        if (y1) {
+            y1[x] = rgb_to_y(p10[ch->r], p10[ch->g], p10[ch->b]);
+            if (has_right) {
+                y1[x + 1] = rgb_to_y(p11[ch->r], p11[ch->g], p11[ch->b]);
+            }
+        }
+
+        int r = (p00[ch->r] + p01[ch->r] + p10[ch->r] + p11[ch->r] + 2) >> 2;
+        int g = (p00[ch->g] + p01[ch->g] + p10[ch->g] + p11[ch->g] + 2) >> 2;
+        int b = (p00[ch->b] + p01[ch->b] + p10[ch->b] + p11[ch->b] + 2) >> 2;
+        u[x / 2] = rgb_to_u(r, g, b);
+        v[x / 2] = rgb_to_v(r, g, b);
+    }
+}
+
+static void convert_scalar(
+    const uint8_t* src, int src_stride,
+    uint8_t* dst_y, int y_stride,
+    uint8_t* dst_u, int u_stride,
+    uint8_t* dst_v, int v_stride,
+    int width, int height,
+    const ChannelOffsets* ch
+) {
+    for (int y = 0; y < height; y += 2) {
+        const uint8_t* row0 = src + (ptrdiff_t)y * src_stride;
+        int has_next = y + 1 < height;
+        convert_row_pair_scalar(
+            row0, has_next ? row0 + src_stride : row0,
+            dst_y + (ptrdiff_t)y * y_stride, has_next ? dst_y + (ptrdiff_t)(y + 1) * y_stride : NULL,
+            dst_u + (ptrdiff_t)(y / 2) * u_stride, dst_v + (ptrdiff_t)(y / 2) * v_stride,
+            0, width, ch
+        );
+    }
+}
+
+// ==========================================
+// SSE2 (16 pixels per row pair iteration)
+// ==========================================
+
+#ifdef COLORCONV_X86
+
+// One channel of 8 pixels (two registers of 4) as 8 x int16
+static inline __m128i sse2_channel(__m128i a, __m128i b, __m128i shift) {
+    const __m128i mask = _mm_set1_epi32(0xFF);
+    __m128i ca = _mm_and_si128(_mm_srl_epi32(a, shift), mask);
+    __m128i cb = _mm_and_si128(_mm_srl_epi32(b, shift), mask);
+    return _mm_packs_epi32(ca, cb);
+}
+
+static inline __m128i sse2_luma(__m128i r, __m128i g, __m128i b) {
+    // Unsigned 16-bit arithmetic: the weighted sum peaks at 56228
+    __m128i y = _mm_add_epi16(_mm_mullo_epi16(r, _mm_set1_epi16(66)), _mm_mullo_epi16(g, _mm_set1_epi16(129)));
+    y = _mm_add_epi16(y, _mm_mullo_epi16(b, _mm_set1_epi16(25)));
+    y = _mm_srli_epi16(_mm_add_epi16(y, _mm_set1_epi16(128)), 8);
+    return _mm_add_epi16(y, _mm_set1_epi16(16));
+}
+
+// Rounded 2x2 averages of 16 pixels (lo = pixels 0-7, hi = 8-15) -> 8 x int16
+static inline __m128i sse2_block_avg(__m128i top_lo, __m128i bot_lo, __m128i top_hi, __m128i bot_hi) {
+    const __m128i ones = _mm_set1_epi16(1);
+    __m128i lo = _mm_madd_epi16(_mm_add_epi16(top_lo, bot_lo), ones);
+    __m128i hi = _mm_madd_epi16(_mm_add_epi16(top_hi, bot_hi), ones);
+    __m128i sum = _mm_packs_epi32(lo, hi);
+    return _mm_srli_epi16(_mm_add_epi16(sum, _mm_set1_epi16(2)), 2);
+}
+
+static inline __m128i sse2_chroma(__m128i r, __m128i g, __m128i b, short cr, short cg, short cb) {
+    __m128i c = _mm_add_epi16(_mm_mullo_epi16(r, _mm_set1_epi16(cr)), _mm_mullo_epi16(g, _mm_set1_epi16(cg)));
+    c = _mm_add_epi16(c, _mm_mullo_epi16(b, _mm_set1_epi16(cb)));
+    c = _mm_srai_epi16(_mm_add_epi16(c, _mm_set1_epi16(128)), 8);
+    return _mm_add_epi16(c, _mm_set1_epi16(128));
+}
+
+static void convert_sse2(
+    const uint8_t* src, int src_stride,
+    uint8_t* dst_y, int y_stride,
+    uint8_t* dst_u, int u_stride,
+    uint8_t* dst_v, int v_stride,
+    int width, int height,
+    const ChannelOffsets* ch
+) {
+    const __m128i rs = _mm_cvtsi32_si128(ch->r * 8);
+    const __m128i gs = _mm_cvtsi32_si128(ch->g * 8);
+    const __m128i bs = _mm_cvtsi32_si128(ch->b * 8);
+    const __m128i zero = _mm_setzero_si128();
+    int pairs = height / 2;
+
+    for (int j = 0; j < pairs; j++) {
+        const uint8_t* row0 = src + (ptrdiff_t)(2 * j) * src_stride;
+        const uint8_t* row1 = row0 + src_stride;
+        uint8_t* y0 = dst_y + (ptrdiff_t)(2 * j) * y_stride;
+        uint8_t* y1 = y0 + y_stride;
+        uint8_t* u = dst_u + (ptrdiff_t)j * u_stride;
+        uint8_t* v = dst_v + (ptrdiff_t)j * v_stride;
+        int x = 0;
+
+        for (; x + 16 <= width; x += 16) {
+            const uint8_t* p0 = row0 + x * 4;
+            const uint8_t* p1 = row1 + x * 4;
+            __m128i a0 = _mm_loadu_si128((const __m128i*)p0);
+            __m128i a1 = _mm_loadu_si128((const __m128i*)(p0 + 16));
+            __m128i a2 = _mm_loadu_si128((const __m128i*)(p0 + 32));
+            __m128i a3 = _mm_loadu_si128((const __m128i*)(p0 + 48));
+            __m128i b0 = _mm_loadu_si128((const __m128i*)p1);
+            __m128i b1 = _mm_loadu_si128((const __m128i*)(p1 + 16));
+            __m128i b2 = _mm_loadu_si128((const __m128i*)(p1 + 32));
+            __m128i b3 = _mm_loadu_si128((const __m128i*)(p1 + 48));
+
+            __m128i r0lo = sse2_channel(a0, a1, rs), r0hi = sse2_channel(a2, a3, rs);
+            __m128i g0lo = sse2_channel(a0, a1, gs), g0hi = sse2_channel(a2, a3, gs);
+            __m128i b0lo = sse2_channel(a0, a1, bs), b0hi = sse2_channel(a2, a3, bs);
+            __m128i r1lo = sse2_channel(b0, b1, rs), r1hi = sse2_channel(b2, b3, rs);
+            __m128i g1lo = sse2_channel(b0, b1, gs), g1hi = sse2_channel(b2, b3, gs);
+            __m128i b1lo = sse2_channel(b0, b1, bs), b1hi = sse2_channel(b2, b3, bs);
+
+            _mm_storeu_si128((__m128i*)(y0 + x),
+                _mm_packus_epi16(sse2_luma(r0lo, g0lo, b0lo), sse2_luma(r0hi, g0hi, b0hi)));
+            _mm_storeu_si128((__m128i*)(y1 + x),
+                _mm_packus_epi16(sse2_luma(r1lo, g1lo, b1lo), sse2_luma(r1hi, g1hi, b1hi)));
+
+            __m128i ra = sse2_block_avg(r0lo, r1lo, r0hi, r1hi);
+            __m128i ga = sse2_block_avg(g0lo, g1lo, g0hi, g1hi);
+            __m128i ba = sse2_block_avg(b0lo, b1lo, b0hi, b1hi);
+
+            _mm_storel_epi64((__m128i*)(u + x / 2), _mm_packus_epi16(sse2_chroma(ra, ga, ba, -38, -74, 112), zero));
+            _mm_storel_epi64((__m128i*)(v + x / 2), _mm_packus_epi16(sse2_chroma(ra, ga, ba, 112, -94, -18), zero));
+        }
+
+        convert_row_pair_scalar(row0, row1, y0, y1, u, v, x, width, ch);
+    }
+
+    if (height & 1) {
+        const uint8_t* last = src + (ptrdiff_t)(height - 1) * src_stride;
+        convert_row_pair_scalar(
+            last, last, dst_y + (ptrdiff_t)(height - 1) * y_stride, NULL,
+            dst_u + (ptrdiff_t)pairs * u_stride, dst_v + (ptrdiff_t)pairs * v_stride,
+            0, width, ch
+        );
+    }
+}
+
+// ==========================================
+// AVX2 (32 pixels per row pair iteration)
+// ==========================================
+
+// packs/packus work per 128-bit lane; this restores natural element order
+#define AVX2_FIX_ORDER(x) _mm256_permute4x64_epi64((x), 0xD8)
+
+TARGET_AVX2 static inline __m256i avx2_channel(__m256i a, __m256i b, __m128i shift) {
+    const __m256i mask = _mm256_set1_epi32(0xFF);
+    __m256i ca = _mm256_and_si256(_mm256_srl_epi32(a, shift), mask);
+    __m256i cb = _mm256_and_si256(_mm256_srl_epi32(b, shift), mask);
+    return AVX2_FIX_ORDER(_mm256_packs_epi32(ca, cb));
+}
+
+TARGET_AVX2 static inline __m256i avx2_luma(__m256i r, __m256i g, __m256i b) {
+    __m256i y = _mm256_add_epi16(_mm256_mullo_epi16(r, _mm256_set1_epi16(66)), _mm256_mullo_epi16(g, _mm256_set1_epi16(129)));
+    y = _mm256_add_epi16(y, _mm256_mullo_epi16(b, _mm256_set1_epi16(25)));
+    y = _mm256_srli_epi16(_mm256_add_epi16(y, _mm256_set1_epi16(128)), 8);
+    return _mm256_add_epi16(y, _mm256_set1_epi16(16));
+}
+
+TARGET_AVX2 static inline __m256i avx2_block_avg(__m256i top_lo, __m256i bot_lo, __m256i top_hi, __m256i bot_hi) {
+    const __m256i ones = _mm256_set1_epi16(1);
+    __m256i lo = _mm256_madd_epi16(_mm256_add_epi16(top_lo, bot_lo), ones);
+    __m256i hi = _mm256_madd_epi16(_mm256_add_epi16(top_hi, bot_hi), ones);
+    __m256i sum = AVX2_FIX_ORDER(_mm256_packs_epi32(lo, hi));
+    return _mm256_srli_epi16(_mm256_add_epi16(sum, _mm256_set1_epi16(2)), 2);
+}
+
+TARGET_AVX2 static inline __m256i avx2_chroma(__m256i r, __m256i g, __m256i b, short cr, short cg, short cb) {
+    __m256i c = _mm256_add_epi16(_mm256_mullo_epi16(r, _mm256_set1_epi16(cr)), _mm256_mullo_epi16(g, _mm256_set1_epi16(cg)));
+    c = _mm256_add_epi16(c, _mm256_mullo_epi16(b, _mm256_set1_epi16(cb)));
+    c = _mm256_srai_epi16(_mm256_add_epi16(c, _mm256_set1_epi16(128)), 8);
+    return _mm256_add_epi16(c, _mm256_set1_epi16(128));
+}
+
+TARGET_AVX2 static void convert_avx2(
+    const uint8_t* src, int src_stride,
+    uint8_t* dst_y, int y_stride,
+    uint8_t* dst_u, int u_stride,
+    uint8_t* dst_v, int v_stride,
+    int width, int height,
+    const ChannelOffsets* ch
+) {
+    const __m128i rs = _mm_cvtsi32_si128(ch->r * 8);
+    const __m128i gs = _mm_cvtsi32_si128(ch->g * 8);
+    const __m128i bs = _mm_cvtsi32_si128(ch->b * 8);
+    int pairs = height / 2;
+
+    for (int j = 0; j < pairs; j++) {
+        const uint8_t* row0 = src + (ptrdiff_t)(2 * j) * src_stride;
+        const uint8_t* row1 = row0 + src_stride;
+        uint8_t* y0 = dst_y + (ptrdiff_t)(2 * j) * y_stride;
+        uint8_t* y1 = y0 + y_stride;
+        uint8_t* u = dst_u + (ptrdiff_t)j * u_stride;
+        uint8_t* v = dst_v + (ptrdiff_t)j * v_stride;
+        int x = 0;
+
+        for (; x + 32 <= width; x += 32) {
+            const uint8_t* p0 = row0 + x * 4;
+            const uint8_t* p1 = row1 + x * 4;
+            __m256i a0 = _mm256_loadu_si256((const __m256i*)p0);
+            __m256i a1 = _mm256_loadu_si256((const __m256i*)(p0 + 32));
+            __m256i a2 = _mm256_loadu_si256((const __m256i*)(p0 + 64));
+            __m256i a3 = _mm256_loadu_si256((const __m256i*)(p0 + 96));
+            __m256i b0 = _mm256_loadu_si256((const __m256i*)p1);
+            __m256i b1 = _mm256_loadu_si256((const __m256i*)(p1 + 32));
+            __m256i b2 = _mm256_loadu_si256((const __m256i*)(p1 + 64));
+            __m256i b3 = _mm256_loadu_si256((const __m256i*)(p1 + 96));
+
+            __m256i r0lo = avx2_channel(a0, a1, rs), r0hi = avx2_channel(a2, a3, rs);
+            __m256i g0lo = avx2_channel(a0, a1, gs), g0hi = avx2_channel(a2, a3, gs);
+            __m256i b0lo = avx2_channel(a0, a1, bs), b0hi = avx2_channel(a2, a3, bs);
+            __m256i r1lo = avx2_channel(b0, b1, rs), r1hi = avx2_channel(b2, b3, rs);
+            __m256i g1lo = avx2_channel(b0, b1, gs), g1hi = avx2_channel(b2, b3, gs);
+            __m256i b1lo = avx2_channel(b0, b1, bs), b1hi = avx2_channel(b2, b3, bs);
+
+            _mm256_storeu_si256((__m256i*)(y0 + x),
+                AVX2_FIX_ORDER(_mm256_packus_epi16(avx2_luma(r0lo, g0lo, b0lo), avx2_luma(r0hi, g0hi, b0hi))));
+            _mm256_storeu_si256((__m256i*)(y1 + x),
+                AVX2_FIX_ORDER(_mm256_packus_epi16(avx2_luma(r1lo, g1lo, b1lo), avx2_luma(r1hi, g1hi, b1hi))));
+
+            __m256i ra = avx2_block_avg(r0lo, r1lo, r0hi, r1hi);
+            __m256i ga = avx2_block_avg(g0lo, g1lo, g0hi, g1hi);
+            __m256i ba = avx2_block_avg(b0lo, b1lo, b0hi, b1hi);
+
+            // After reordering: low 128 bits = 16 U samples, high 128 bits = 16 V samples
+            __m256i uv = AVX2_FIX_ORDER(_mm256_packus_epi16(
+                avx2_chroma(ra, ga, ba, -38, -74, 112),
+                avx2_chroma(ra, ga, ba, 112, -94, -18)));
+            _mm_storeu_si128((__m128i*)(u + x / 2), _mm256_castsi256_si128(uv));
+            _mm_storeu_si128((__m128i*)(v + x / 2), _mm256_extracti128_si256(uv, 1));
+        }
+
+        convert_row_pair_scalar(row0, row1, y0, y1, u, v, x, width, ch);
+    }
+
+    if (height & 1) {
+        const uint8_t* last = src + (ptrdiff_t)(height - 1) * src_stride;
+        convert_row_pair_scalar(
+            last, last, dst_y + (ptrdiff_t)(height - 1) * y_stride, NULL,
+            dst_u + (ptrdiff_t)pairs * u_stride, dst_v + (ptrdiff_t)pairs * v_stride,
+            0, width, ch
+        );
+    }
+}
+
+static int cpu_has_avx2(void) {
+#if defined(_MSC_VER)
+    int info[4];
+    __cpuid(info, 0);
+    if (info[0] < 7) {
+        return 0;
+    }
+    __cpuid(info, 1);
+    // OSXSAVE and AVX, then check the OS saves YMM state
+    if ((info[2] & (1 << 27)) == 0 || (info[2] & (1 << 28)) == 0) {
+        return 0;
+    }
+    if ((_xgetbv(0) & 0x6) != 0x6) {
+        return 0;
+    }
+    __cpuidex(info, 7, 0);
+    return (info[1] & (1 << 5)) != 0;
+#elif defined(__GNUC__) || defined(__clang__)
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("avx2");
+#else
+    return 0;
+#endif
+}
+
+#endif // COLORCONV_X86
+
+// ==========================================
+// NEON (16 pixels per row pair iteration)
+// ==========================================
+
+#ifdef COLORCONV_NEON
+
+static inline uint8x8_t neon_luma(uint8x8_t r, uint8x8_t g, uint8x8_t b) {
+    uint16x8_t y = vmull_u8(r, vdup_n_u8(66));
+    y = vmlal_u8(y, g, vdup_n_u8(129));
+    y = vmlal_u8(y, b, vdup_n_u8(25));
+    y = vaddq_u16(y, vdupq_n_u16(128));
+    return vadd_u8(vshrn_n_u16(y, 8), vdup_n_u8(16));
+}
+
+// Rounded 2x2 averages of 16 pixels -> 8 x int16
+static inline int16x8_t neon_block_avg(uint8x16_t top, uint8x16_t bot) {
+    uint16x8_t sum = vaddq_u16(vpaddlq_u8(top), vpaddlq_u8(bot));
+    return vreinterpretq_s16_u16(vshrq_n_u16(vaddq_u16(sum, vdupq_n_u16(2)), 2));
+}
+
+static inline uint8x8_t neon_chroma(int16x8_t r, int16x8_t g, int16x8_t b, int16_t cr, int16_t cg, int16_t cb) {
+    int16x8_t c = vmulq_n_s16(r, cr);
+    c = vmlaq_n_s16(c, g, cg);
+    c = vmlaq_n_s16(c, b, cb);
+    c = vshrq_n_s16(vaddq_s16(c, vdupq_n_s16(128)), 8);
+    return vqmovun_s16(vaddq_s16(c, vdupq_n_s16(128)));
+}
+
+static void convert_neon(
+    const uint8_t* src, int src_stride,
+    uint8_t* dst_y, int y_stride,
+    uint8_t* dst_u, int u_stride,
+    uint8_t* dst_v, int v_stride,
+    int width, int height,
+    const ChannelOffsets* ch
+) {
+    int pairs = height / 2;
+
+    for (int j = 0; j < pairs; j++) {
+        const uint8_t* row0 = src + (ptrdiff_t)(2 * j) * src_stride;
+        const uint8_t* row1 = row0 + src_stride;
+        uint8_t* y0 = dst_y + (ptrdiff_t)(2 * j) * y_stride;
+        uint8_t* y1 = y0 + y_stride;
+        uint8_t* u = dst_u + (ptrdiff_t)j * u_stride;
+        uint8_t* v = dst_v + (ptrdiff_t)j * v_stride;
+        int x = 0;
+
+        for (; x + 16 <= width; x += 16) {
+            uint8x16x4_t p0 = vld4q_u8(row0 + x * 4);
+            uint8x16x4_t p1 = vld4q_u8(row1 + x * 4);
+            uint8x16_t r0 = p0.val[ch->r], g0 = p0.val[ch->g], b0 = p0.val[ch->b];
+            uint8x16_t r1 = p1.val[ch->r], g1 = p1.val[ch->g], b1 = p1.val[ch->b];
+
+            vst1q_u8(y0 + x, vcombine_u8(
+                neon_luma(vget_low_u8(r0), vget_low_u8(g0), vget_low_u8(b0)),
+                neon_luma(vget_high_u8(r0), vget_high_u8(g0), vget_high_u8(b0))));
+            vst1q_u8(y1 + x, vcombine_u8(
+                neon_luma(vget_low_u8(r1), vget_low_u8(g1), vget_low_u8(b1)),
+                neon_luma(vget_high_u8(r1), vget_high_u8(g1), vget_high_u8(b1))));
+
+            int16x8_t ra = neon_block_avg(r0, r1);
+            int16x8_t ga = neon_block_avg(g0, g1);
+            int16x8_t ba = neon_block_avg(b0, b1);
+
+            vst1_u8(u + x / 2, neon_chroma(ra, ga, ba, -38, -74, 112));
+            vst1_u8(v + x / 2, neon_chroma(ra, ga, ba, 112, -94, -18));
+        }
+
+        convert_row_pair_scalar(row0, row1, y0, y1, u, v, x, width, ch);
+    }
+
+    if (height & 1) {
+        const uint8_t* last = src + (ptrdiff_t)(height - 1) * src_stride;
+        convert_row_pair_scalar(
+            last, last, dst_y + (ptrdiff_t)(height - 1) * y_stride, NULL,
+            dst_u + (ptrdiff_t)pairs * u_stride, dst_v + (ptrdiff_t)pairs * v_stride,
+            0, width, ch
+        );
+    }
+}
+
+#endif // COLORCONV_NEON
+
+// ==========================================
+// DISPATCH
+// ==========================================
+
+static ConvertFunc g_convert = NULL;
+static const char* g_convert_name = "scalar";
+
+const char* rtmp_colorconv_init(void) {
+    if (g_convert) {
+        return g_convert_name;
+    }
+
+    ConvertFunc func = convert_scalar;
+    const char* name = "scalar";
+
+#if defined(COLORCONV_NEON)
+    func = convert_neon;
+    name = "neon";
+#elif defined(COLORCONV_X86)
+    func = convert_sse2;
+    name = "sse2";
+    if (cpu_has_avx2()) {
+        func = convert_avx2;
+        name = "avx2";
+    }
+#endif
+
+    // Benign race: concurrent callers all pick the same kernel
+    g_convert_name = name;
+    g_convert = func;
+    return name;
+}
+
+int rtmp_colorconv_select(const char* name) {
+    ConvertFunc func = NULL;
+    const char* selected = NULL;
+
+    if (strcmp(name, "scalar") == 0) {
+        func = convert_scalar;
+        selected = "scalar";
+    }
+#if defined(COLORCONV_NEON)
+    if (strcmp(name, "neon") == 0) {
+        func = convert_neon;
+        selected = "neon";
+    }
+#elif defined(COLORCONV_X86)
+    if (strcmp(name, "sse2") == 0) {
+        func = convert_sse2;
+        selected = "sse2";
+    } else if (strcmp(name, "avx2") == 0 && cpu_has_avx2()) {
+        func = convert_avx2;
+        selected = "avx2";
+    }
+#endif
+
+    if (!func) {
+        return 0;
+    }
+    g_convert_name = selected;
+    g_convert = func;
+    return 1;
+}
+
+void rtmp_rgba_to_i420(
+    const uint8_t* src, int src_stride,
+    uint8_t* dst_y, int y_stride,
+    uint8_t* dst_u, int u_stride,
+    uint8_t* dst_v, int v_stride,
+    int width, int height
+) {
+    if (!g_convert) {
+        rtmp_colorconv_init();
+    }
+
+    g_convert(src, src_stride, dst_y, y_stride, dst_u, u_stride, dst_v, v_stride, width, height, &RGBA_OFFSETS);
+}
+
+void rtmp_bgra_to_i420(
+    const uint8_t* src, int src_stride,
+    uint8_t* dst_y, int y_stride,
+    uint8_t* dst_u, int u_stride,
+    uint8_t* dst_v, int v_stride,
+    int width, int height
+) {
+    if (!g_convert) {
+        rtmp_colorconv_init();
+    }
+
+    g_convert(src, src_stride, dst_y, y_stride, dst_u, u_stride, dst_v, v_stride, width, height, &BGRA_OFFSETS);
+}
+
+void rtmp_argb_to_i420(
+    const uint8_t* src, int src_stride,
+    uint8_t* dst_y, int y_stride,
+    uint8_t* dst_u, int u_stride,
+    uint8_t* dst_v, int v_stride,
+    int width, int height
+) {
+    if (!g_convert) {
+        rtmp_colorconv_init();
+    }
+
+    g_convert(src, src_stride, dst_y, y_stride, dst_u, u_stride, dst_v, v_stride, width, height, &ARGB_OFFSETS);
+}
+
+// ==========================================
+// NV12
+// ==========================================
+
+static void copy_luma(const uint8_t* src, int src_stride, uint8_t* dst, int dst_stride, int width, int height) {
+    for (int y = 0; y < height; y++) {
+        const uint8_t* s = src + (ptrdiff_t)y * src_stride;
+        uint8_t* d = dst + (ptrdiff_t)y * dst_stride;
+        for (int x = 0; x < width; x++) {
+            d[x] = s[x];
+        }
+    }
+}
+
+void rtmp_nv12_to_i420(
+    const uint8_t* src_y, int src_y_stride,
+    const uint8_t* src_uv, int src_uv_stride,
+    uint8_t* dst_y, int y_stride,
+    uint8_t* dst_u, int u_stride,
+    uint8_t* dst_v, int v_stride,
+    int width, int height
+) {
+    copy_luma(src_y, src_y_stride, dst_y, y_stride, width, height);
+
+    // Plain loops: compilers vectorise the deinterleave on their own
+    int chroma_width = (width + 1) / 2;
+    int chroma_height = (height + 1) / 2;
+    for (int y = 0; y < chroma_height; y++) {
+        const uint8_t* uv = src_uv + (ptrdiff_t)y * src_uv_stride;
+        uint8_t* u = dst_u + (ptrdiff_t)y * u_stride;
+        uint8_t* v = dst_v + (ptrdiff_t)y * v_stride;
+        for (int x = 0; x < chroma_width; x++) {
+            u[x] = uv[2 * x];
+            v[x] = uv[2 * x + 1];
+        }
+    }
+}
+
+void rtmp_i420_to_nv12(
+    const uint8_t* src_y, int src_y_stride,
+    const uint8_t* src_u, int src_u_stride,
+    const uint8_t* src_v, int src_v_stride,
+    uint8_t* dst_y, int y_stride,
+    uint8_t* dst_uv, int uv_stride,
+    int width, int height
+) {
+    copy_luma(src_y, src_y_stride, dst_y, y_stride, width, height);
+
+    int chroma_width = (width + 1) / 2;
+    int chroma_height = (height + 1) / 2;
+    for (int y = 0; y < chroma_height; y++) {
+        const uint8_t* u = src_u + (ptrdiff_t)y * src_u_stride;
+        const uint8_t* v = src_v + (ptrdiff_t)y * src_v_stride;
+        uint8_t* uv = dst_uv + (ptrdiff_t)y * uv_stride;
+        for (int x = 0; x < chroma_width; x++) {
+            uv[2 * x] = u[x];
+            uv[2 * x + 1] = v[x];
+        }
+    }
+}
@@ -0,0 +1,114 @@
+/**
+ * FFmpeg RTMP Bridge - Colour Conversion
+ *
+ * Fixed-size RGBA/BGRA/ARGB -> I420 (YUV420P) conversion used on the per-frame hot path
+ * instead of a generic swscale call. BT.601 limited range, chroma is the
+ * rounded average of each 2x2 block.
+ *
+ * SSE2/AVX2 (x86) and NEON (ARM) kernels are selected at runtime; all paths
+ * produce bit-identical output to the scalar reference.
+ */
+
+#ifndef FFMPEG_RTMP_COLORCONV_H
+#define FFMPEG_RTMP_COLORCONV_H
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Select the fastest kernel for this CPU. Safe to call more than once.
+ *
+ * @return Name of the selected kernel ("avx2", "sse2", "neon" or "scalar")
+ */
+const char* rtmp_colorconv_init(void);
+
+/**
+ * Force a kernel by name, e.g. to check it against the scalar reference.
+ *
+ * @param name "scalar", "sse2", "avx2" or "neon"
+ * @return 1 if selected, 0 if it is not built in or this CPU lacks it
+ */
+int rtmp_colorconv_select(const char* name);
+
+/**
+ * Convert an RGBA image to I420.
+ *
+ * @param src RGBA pixels, 4 bytes per pixel
+ * @param src_stride Bytes between rows of src. May be negative, with src
+ *                   pointing at the last row, to read the image bottom-up.
+ * @param dst_y, dst_u, dst_v Destination planes (U/V are half size, rounded up)
+ * @param y_stride, u_stride, v_stride Bytes between rows of each plane
+ * @param width, height Image size in pixels
+ */
+void rtmp_rgba_to_i420(
+    const uint8_t* src, int src_stride,
+    uint8_t* dst_y, int y_stride,
+    uint8_t* dst_u, int u_stride,
+    uint8_t* dst_v, int v_stride,
+    int width, int height
+);
+
+/**
+ * Convert a BGRA image (D3D11/Metal byte order) to I420. Same parameters as
+ * rtmp_rgba_to_i420.
+ */
+void rtmp_bgra_to_i420(
+    const uint8_t* src, int src_stride,
+    uint8_t* dst_y, int y_stride,
+    uint8_t* dst_u, int u_stride,
+    uint8_t* dst_v, int v_stride,
+    int width, int height
+);
+
+/**
+ * Convert an ARGB image (alpha first in memory) to I420. Same parameters as
+ * rtmp_rgba_to_i420.
+ */
+void rtmp_argb_to_i420(
+    const uint8_t* src, int src_stride,
+    uint8_t* dst_y, int y_stride,
+    uint8_t* dst_u, int u_stride,
+    uint8_t* dst_v, int v_stride,
+    int width, int height
+);
+
+/**
+ * Split an NV12 image (Y plane + interleaved UV plane) into I420 planes, for
+ * encoders that only take I420. Strides may be negative as above.
+ *
+ * @param src_y, src_uv Source planes
+ * @param src_y_stride, src_uv_stride Bytes between rows of each source plane
+ * @param dst_y, dst_u, dst_v Destination planes (U/V are half size, rounded up)
+ * @param y_stride, u_stride, v_stride Bytes between rows of each plane
+ * @param width, height Image size in pixels
+ */
+void rtmp_nv12_to_i420(
+    const uint8_t* src_y, int src_y_stride,
+    const uint8_t* src_uv, int src_uv_stride,
+    uint8_t* dst_y, int y_stride,
+    uint8_t* dst_u, int u_stride,
+    uint8_t* dst_v, int v_stride,
+    int width, int height
+);
+
+/**
+ * Merge I420 planes into NV12, for encoders that only take NV12. Same
+ * parameters as rtmp_nv12_to_i420, with source and destination swapped.
+ */
+void rtmp_i420_to_nv12(
+    const uint8_t* src_y, int src_y_stride,
+    const uint8_t* src_u, int src_u_stride,
+    const uint8_t* src_v, int src_v_stride,
+    uint8_t* dst_y, int y_stride,
+    uint8_t* dst_uv, int uv_stride,
+    int width, int height
+);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // FFMPEG_RTMP_COLORCONV_H
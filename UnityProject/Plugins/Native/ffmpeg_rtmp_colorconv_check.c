@@ -0,0 +1,322 @@
+/**
+ * FFmpeg RTMP Bridge - Colour Conversion Check
+ *
+ * Runs every colour conversion kernel this CPU supports and exits non-zero
+ * on a mismatch:
+ *
+ * - Each SIMD kernel against the scalar reference, on random pixels. The
+ *   kernels promise bit-identical output, so any difference fails.
+ * - Each kernel against sws_scale (BT.601 limited range), on smooth
+ *   gradients, where the two chroma filters agree. Differences beyond
+ *   +-1 fail; the fixed point coefficients round differently from swscale.
+ * - NV12 <-> I420 round trips.
+ *
+ * Sizes are odd and tiny as well as larger, sources are read top-down and
+ * bottom-up (negative stride), and destination row padding is checked to
+ * stay untouched. Built and registered with CTest by CMakeLists.txt.
+ */
+
+#include "ffmpeg_rtmp_colorconv.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <libavutil/pixfmt.h>
+#include <libswscale/swscale.h>
+
+#define SWSCALE_TOLERANCE 1
+#define ROW_PADDING 24      // bytes after each row, to catch writes past the width
+#define CANARY 0xCD
+
+typedef void (*PackedToI420)(
+    const uint8_t* src, int src_stride,
+    uint8_t* dst_y, int y_stride,
+    uint8_t* dst_u, int u_stride,
+    uint8_t* dst_v, int v_stride,
+    int width, int height
+);
+
+typedef struct {
+    const char* name;
+    PackedToI420 convert;
+    enum AVPixelFormat av_format;
+    int r, g, b, a;         // byte offsets within a pixel
+} PackedFormat;
+
+static const PackedFormat FORMATS[] = {
+    { "rgba", rtmp_rgba_to_i420, AV_PIX_FMT_RGBA, 0, 1, 2, 3 },
+    { "bgra", rtmp_bgra_to_i420, AV_PIX_FMT_BGRA, 2, 1, 0, 3 },
+    { "argb", rtmp_argb_to_i420, AV_PIX_FMT_ARGB, 1, 2, 3, 0 },
+};
+
+static const char* KERNELS[] = { "sse2", "avx2", "neon" };
+
+static const int SIZES[][2] = {
+    { 1, 1 }, { 2, 2 }, { 3, 1 }, { 1, 3 }, { 3, 5 }, { 15, 7 }, { 17, 9 },
+    { 31, 33 }, { 33, 31 }, { 65, 3 }, { 127, 45 }, { 640, 360 }, { 641, 361 },
+};
+
+// I420 image with ROW_PADDING bytes of canary after every row
+typedef struct {
+    uint8_t* data[3];
+    int stride[3];
+    int width[3];
+    int height[3];
+} Image;
+
+static int g_failures = 0;
+
+static uint32_t g_seed = 12345;
+
+static uint8_t next_random(void) {
+    g_seed = g_seed * 1664525u + 1013904223u;
+    return (uint8_t)(g_seed >> 24);
+}
+
+static int clamp_byte(int v) {
+    return v < 0 ? 0 : v > 255 ? 255 : v;
+}
+
+static void image_alloc(Image* img, int width, int height) {
+    int cw = (width + 1) / 2;
+    int ch = (height + 1) / 2;
+    int widths[3] = { width, cw, cw };
+    int heights[3] = { height, ch, ch };
+
+    for (int p = 0; p < 3; p++) {
+        img->width[p] = widths[p];
+        img->height[p] = heights[p];
+        img->stride[p] = widths[p] + ROW_PADDING;
+        img->data[p] = malloc((size_t)img->stride[p] * heights[p]);
+        if (!img->data[p]) {
+            fprintf(stderr, "out of memory\n");
+            exit(2);
+        }
+        memset(img->data[p], CANARY, (size_t)img->stride[p] * heights[p]);
+    }
+}
+
+static void image_free(Image* img) {
+    for (int p = 0; p < 3; p++) {
+        free(img->data[p]);
+    }
+}
+
+static void fail(const char* what, const char* kernel, const char* format, int width, int height, int flipped, const char* detail) {
+    fprintf(stderr, "FAIL %s: %s %s %dx%d%s: %s\n", what, kernel, format, width, height, flipped ? " bottom-up" : "", detail);
+    g_failures++;
+}
+
+// Largest per-sample difference over the visible area, -1 if a padding byte changed
+static int image_max_diff(const Image* a, const Image* b) {
+    int max_diff = 0;
+    for (int p = 0; p < 3; p++) {
+        for (int y = 0; y < a->height[p]; y++) {
+            const uint8_t* ra = a->data[p] + (size_t)y * a->stride[p];
+            const uint8_t* rb = b->data[p] + (size_t)y * b->stride[p];
+            for (int x = 0; x < a->width[p]; x++) {
+                int d = abs((int)ra[x] - (int)rb[x]);
+                if (d > max_diff) {
+                    max_diff = d;
+                }
+            }
+            for (int x = a->width[p]; x < a->stride[p]; x++) {
+                if (ra[x] != CANARY) {
+                    return -1;
+                }
+            }
+        }
+    }
+    return max_diff;
+}
+
+static void describe_diff(int diff, char* detail, size_t size) {
+    if (diff < 0) {
+        snprintf(detail, size, "wrote past the row");
+    } else {
+        snprintf(detail, size, "max difference %d", diff);
+    }
+}
+
+// Packed source of width x height pixels, either random or a smooth gradient
+static uint8_t* make_source(const PackedFormat* fmt, int width, int height, int stride, int smooth) {
+    uint8_t* src = malloc((size_t)stride * height);
+    if (!src) {
+        fprintf(stderr, "out of memory\n");
+        exit(2);
+    }
+    memset(src, CANARY, (size_t)stride * height);
+
+    for (int y = 0; y < height; y++) {
+        uint8_t* row = src + (size_t)y * stride;
+        for (int x = 0; x < width; x++) {
+            uint8_t* px = row + x * 4;
+            if (smooth) {
+                // At most one level per pixel, so chroma siting differences stay well below 1
+                px[fmt->r] = (uint8_t)clamp_byte(40 + (x + y) / 2);
+                px[fmt->g] = (uint8_t)clamp_byte(200 - x / 3 + y / 4);
+                px[fmt->b] = (uint8_t)clamp_byte(90 + (y - x) / 3);
+            } else {
+                px[fmt->r] = next_random();
+                px[fmt->g] = next_random();
+                px[fmt->b] = next_random();
+            }
+            px[fmt->a] = next_random();
+        }
+    }
+    return src;
+}
+
+static void convert(const PackedFormat* fmt, const uint8_t* src, int src_stride, Image* dst, int width, int height) {
+    fmt->convert(
+        src, src_stride,
+        dst->data[0], dst->stride[0],
+        dst->data[1], dst->stride[1],
+        dst->data[2], dst->stride[2],
+        width, height
+    );
+}
+
+static int convert_swscale(const PackedFormat* fmt, const uint8_t* src, int src_stride, Image* dst, int width, int height) {
+    // Same settings as the bridge's RTMP_VERIFY_COLORCONV reference
+    struct SwsContext* sws = sws_getContext(
+        width, height, fmt->av_format,
+        width, height, AV_PIX_FMT_YUV420P,
+        SWS_BILINEAR | SWS_ACCURATE_RND, NULL, NULL, NULL
+    );
+    if (!sws) {
+        return 0;
+    }
+
+    const uint8_t* src_data[4] = { src, NULL, NULL, NULL };
+    int src_linesize[4] = { src_stride, 0, 0, 0 };
+    uint8_t* dst_data[4] = { dst->data[0], dst->data[1], dst->data[2], NULL };
+    int dst_linesize[4] = { dst->stride[0], dst->stride[1], dst->stride[2], 0 };
+    sws_scale(sws, src_data, src_linesize, 0, height, dst_data, dst_linesize);
+    sws_freeContext(sws);
+    return 1;
+}
+
+static void check_packed(const char* kernel, const PackedFormat* fmt, int width, int height, int flipped, int smooth) {
+    int stride = width * 4 + ROW_PADDING;
+    uint8_t* src = make_source(fmt, width, height, stride, smooth);
+
+    // Bottom-up: start at the last row and walk backwards, as the bridge does for flip_vertical
+    const uint8_t* first = flipped ? src + (size_t)(height - 1) * stride : src;
+    int src_stride = flipped ? -stride : stride;
+
+    Image reference, out;
+    image_alloc(&reference, width, height);
+    image_alloc(&out, width, height);
+
+    rtmp_colorconv_select(kernel);
+    convert(fmt, first, src_stride, &out, width, height);
+
+    char detail[64];
+    if (smooth) {
+        if (!convert_swscale(fmt, first, src_stride, &reference, width, height)) {
+            fail("swscale", kernel, fmt->name, width, height, flipped, "sws_getContext failed");
+        } else {
+            int diff = image_max_diff(&out, &reference);
+            if (diff < 0 || diff > SWSCALE_TOLERANCE) {
+                describe_diff(diff, detail, sizeof(detail));
+                fail("swscale", kernel, fmt->name, width, height, flipped, detail);
+            }
+        }
+    } else {
+        rtmp_colorconv_select("scalar");
+        convert(fmt, first, src_stride, &reference, width, height);
+        int diff = image_max_diff(&out, &reference);
+        if (diff != 0) {
+            describe_diff(diff, detail, sizeof(detail));
+            fail("scalar", kernel, fmt->name, width, height, flipped, detail);
+        }
+    }
+
+    image_free(&reference);
+    image_free(&out);
+    free(src);
+}
+
+static void check_nv12_round_trip(int width, int height) {
+    Image in, out;
+    image_alloc(&in, width, height);
+    image_alloc(&out, width, height);
+
+    for (int p = 0; p < 3; p++) {
+        for (int y = 0; y < in.height[p]; y++) {
+            for (int x = 0; x < in.width[p]; x++) {
+                in.data[p][(size_t)y * in.stride[p] + x] = next_random();
+            }
+        }
+    }
+
+    int uv_stride = in.width[1] * 2 + ROW_PADDING;
+    int y_stride = in.stride[0];
+    uint8_t* nv12_y = malloc((size_t)y_stride * height);
+    uint8_t* nv12_uv = malloc((size_t)uv_stride * in.height[1]);
+    if (!nv12_y || !nv12_uv) {
+        fprintf(stderr, "out of memory\n");
+        exit(2);
+    }
+
+    rtmp_i420_to_nv12(
+        in.data[0], in.stride[0], in.data[1], in.stride[1], in.data[2], in.stride[2],
+        nv12_y, y_stride, nv12_uv, uv_stride,
+        width, height
+    );
+    rtmp_nv12_to_i420(
+        nv12_y, y_stride, nv12_uv, uv_stride,
+        out.data[0], out.stride[0], out.data[1], out.stride[1], out.data[2], out.stride[2],
+        width, height
+    );
+
+    int diff = image_max_diff(&out, &in);
+    if (diff != 0) {
+        fail("nv12", "-", "i420", width, height, 0, diff < 0 ? "wrote past the row" : "round trip changed samples");
+    }
+
+    free(nv12_y);
+    free(nv12_uv);
+    image_free(&in);
+    image_free(&out);
+}
+
+int main(void) {
+    int sizes = (int)(sizeof(SIZES) / sizeof(SIZES[0]));
+    int formats = (int)(sizeof(FORMATS) / sizeof(FORMATS[0]));
+
+    for (int k = -1; k < (int)(sizeof(KERNELS) / sizeof(KERNELS[0])); k++) {
+        const char* kernel = k < 0 ? "scalar" : KERNELS[k];
+        if (!rtmp_colorconv_select(kernel)) {
+            printf("%-6s skipped (not available)\n", kernel);
+            continue;
+        }
+
+        int before = g_failures;
+        for (int f = 0; f < formats; f++) {
+            for (int i = 0; i < sizes; i++) {
+                for (int flipped = 0; flipped < 2; flipped++) {
+                    // The scalar path is the reference for random input, so only check it against swscale
+                    if (k >= 0) {
+                        check_packed(kernel, &FORMATS[f], SIZES[i][0], SIZES[i][1], flipped, 0);
+                    }
+                    check_packed(kernel, &FORMATS[f], SIZES[i][0], SIZES[i][1], flipped, 1);
+                }
+            }
+        }
+        printf("%-6s %s\n", kernel, g_failures == before ? "ok" : "FAILED");
+    }
+
+    int before = g_failures;
+    for (int i = 0; i < sizes; i++) {
+        check_nv12_round_trip(SIZES[i][0], SIZES[i][1]);
+    }
+    printf("nv12   %s\n", g_failures == before ? "ok" : "FAILED");
+
+    if (g_failures > 0) {
+        fprintf(stderr, "%d colour conversion check(s) failed\n", g_failures);
+        return 1;
+    }
+    return 0;
+}
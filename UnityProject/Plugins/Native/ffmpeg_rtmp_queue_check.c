@@ -0,0 +1,168 @@
+/**
+ * FFmpeg RTMP Bridge - Send Queue Check
+ *
+ * Exercises the packet queue between the encoders and the sender thread
+ * and exits non-zero on a mismatch:
+ *
+ * - RTMP_DROP_QUEUED flushes with audio at the head, interleaved with
+ *   video, and with no video queued at all: every audio packet comes out
+ *   intact and in order, video resumes at the next keyframe.
+ * - RTMP_DROP_NEWEST drops incoming video until the next keyframe.
+ *
+ * The queue is internal to the bridge, so the bridge source is built into
+ * this check. Built and registered with CTest by CMakeLists.txt.
+ */
+
+#include "ffmpeg_rtmp_bridge.c"
+
+#define VIDEO 0
+#define AUDIO 1
+#define CAPACITY 4
+
+static int g_failures = 0;
+
+static void check(int ok, const char* what, const char* detail) {
+    if (!ok) {
+        fprintf(stderr, "FAIL %s: %s\n", what, detail);
+        g_failures++;
+    }
+}
+
+// Packet of the given stream whose payload is filled with its pts, so a
+// blanked or swapped packet shows up when it is popped
+static void push(PacketQueue* q, int stream, int key, int64_t pts) {
+    AVPacket* pkt = av_packet_alloc();
+    if (!pkt || av_new_packet(pkt, 16) < 0) {
+        fprintf(stderr, "out of memory\n");
+        exit(2);
+    }
+    memset(pkt->data, (int)(pts & 0xFF), pkt->size);
+    pkt->stream_index = stream;
+    pkt->pts = pkt->dts = pts;
+    if (key) {
+        pkt->flags |= AV_PKT_FLAG_KEY;
+    }
+    packet_queue_push(q, pkt);
+    av_packet_free(&pkt);
+}
+
+// Pops everything queued and compares stream and pts against the expected order
+static void expect(PacketQueue* q, const char* what, const int* streams, const int64_t* pts, int count) {
+    AVPacket* pkt = av_packet_alloc();
+    char detail[128];
+    int popped = 0;
+
+    packet_queue_finish(q);
+    while (packet_queue_pop(q, pkt)) {
+        if (popped < count) {
+            int intact = pkt->size == 16 && pkt->data && pkt->data[0] == (uint8_t)(pts[popped] & 0xFF);
+            snprintf(detail, sizeof(detail), "packet %d: stream %d pts %lld size %d, expected stream %d pts %lld",
+                     popped, pkt->stream_index, (long long)pkt->pts, pkt->size, streams[popped], (long long)pts[popped]);
+            check(pkt->stream_index == streams[popped] && pkt->pts == pts[popped] && intact, what, detail);
+        }
+        popped++;
+        av_packet_unref(pkt);
+    }
+
+    snprintf(detail, sizeof(detail), "popped %d packets, expected %d", popped, count);
+    check(popped == count, what, detail);
+    av_packet_free(&pkt);
+}
+
+static void check_flush_audio_at_head(void) {
+    PacketQueue q = {0};
+    packet_queue_init(&q, CAPACITY, RTMP_DROP_QUEUED, VIDEO);
+
+    push(&q, AUDIO, 0, 1);
+    push(&q, AUDIO, 0, 2);
+    push(&q, VIDEO, 1, 3);
+    push(&q, VIDEO, 0, 4);
+    push(&q, VIDEO, 1, 5);  // full: queued video is flushed, audio stays
+
+    static const int streams[] = { AUDIO, AUDIO, VIDEO };
+    static const int64_t pts[] = { 1, 2, 5 };
+    expect(&q, "flush, audio at head", streams, pts, 3);
+    check(ATOMIC_LOAD(&q.dropped_video) == 2, "flush, audio at head", "expected 2 dropped video packets");
+    packet_queue_destroy(&q);
+}
+
+static void check_flush_interleaved(void) {
+    PacketQueue q = {0};
+    packet_queue_init(&q, CAPACITY, RTMP_DROP_QUEUED, VIDEO);
+
+    // Wrap the ring so the flush crosses its end
+    push(&q, AUDIO, 0, 1);
+    push(&q, AUDIO, 0, 2);
+    AVPacket* pkt = av_packet_alloc();
+    for (int i = 0; i < 2; i++) {
+        packet_queue_pop(&q, pkt);
+        av_packet_unref(pkt);
+    }
+    av_packet_free(&pkt);
+
+    push(&q, AUDIO, 0, 3);
+    push(&q, VIDEO, 1, 4);
+    push(&q, AUDIO, 0, 5);
+    push(&q, VIDEO, 0, 6);
+    push(&q, VIDEO, 0, 7);  // full, not a keyframe: flushed and dropped
+    push(&q, AUDIO, 0, 8);
+    push(&q, VIDEO, 1, 9);
+
+    static const int streams[] = { AUDIO, AUDIO, AUDIO, VIDEO };
+    static const int64_t pts[] = { 3, 5, 8, 9 };
+    expect(&q, "flush, interleaved", streams, pts, 4);
+    packet_queue_destroy(&q);
+}
+
+static void check_flush_audio_only(void) {
+    PacketQueue q = {0};
+    packet_queue_init(&q, CAPACITY, RTMP_DROP_QUEUED, VIDEO);
+
+    for (int i = 1; i <= CAPACITY; i++) {
+        push(&q, AUDIO, 0, i);
+    }
+    push(&q, VIDEO, 1, 10);  // full of audio: nothing to flush, so it is dropped
+
+    static const int streams[] = { AUDIO, AUDIO, AUDIO, AUDIO };
+    static const int64_t pts[] = { 1, 2, 3, 4 };
+    expect(&q, "flush, audio only", streams, pts, 4);
+    packet_queue_destroy(&q);
+}
+
+static void check_drop_newest(void) {
+    PacketQueue q = {0};
+    packet_queue_init(&q, CAPACITY, RTMP_DROP_NEWEST, VIDEO);
+
+    push(&q, VIDEO, 1, 1);
+    push(&q, AUDIO, 0, 2);
+    push(&q, VIDEO, 0, 3);
+    push(&q, AUDIO, 0, 4);
+    push(&q, VIDEO, 0, 5);  // full: dropped, video waits for a keyframe
+
+    AVPacket* pkt = av_packet_alloc();
+    packet_queue_pop(&q, pkt);
+    av_packet_unref(pkt);
+    av_packet_free(&pkt);
+
+    push(&q, VIDEO, 0, 6);  // room again, but not a keyframe
+    push(&q, VIDEO, 1, 7);
+
+    static const int streams[] = { AUDIO, VIDEO, AUDIO, VIDEO };
+    static const int64_t pts[] = { 2, 3, 4, 7 };
+    expect(&q, "drop newest", streams, pts, 4);
+    packet_queue_destroy(&q);
+}
+
+int main(void) {
+    check_flush_audio_at_head();
+    check_flush_interleaved();
+    check_flush_audio_only();
+    check_drop_newest();
+
+    if (g_failures > 0) {
+        fprintf(stderr, "%d send queue check(s) failed\n", g_failures);
+        return 1;
+    }
+    printf("send queue ok\n");
+    return 0;
+}
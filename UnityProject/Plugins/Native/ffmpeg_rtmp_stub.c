@@ -42,6 +42,17 @@ int rtmp_init_simple(int width, int height, int fps, int bitrate_kbps,
     return RTMP_SUCCESS;
 }
 
+int rtmp_init(const void* config) {
+    printf("[RTMP STUB] init (config)\n");
+    set_error("Stub implementation - FFmpeg not available on this platform");
+    g_state = 1;
+    return RTMP_SUCCESS;
+}
+
+int rtmp_init_ex(const void* config) {
+    return rtmp_init(config);
+}
+
 int rtmp_connect(const char* url) {
     printf("[RTMP STUB] connect: %.50s...\n", url);
     printf("[RTMP STUB] WARNING: This is a stub! Real streaming requires FFmpeg.\n");
@@ -49,6 +60,11 @@ int rtmp_connect(const char* url) {
     return RTMP_SUCCESS;
 }
 
+int rtmp_connect_async(const char* url) {
+    // Nothing to wait for; the state is connected as soon as this returns
+    return rtmp_connect(url);
+}
+
 int rtmp_start_streaming(void) {
     printf("[RTMP STUB] start_streaming\n");
     return RTMP_SUCCESS;
@@ -68,11 +84,101 @@ int rtmp_send_video_frame(void* rgba_data, int data_size, long pts) {
     return RTMP_SUCCESS;
 }
 
+int rtmp_send_video_planes(void* plane0, int stride0, void* plane1, int stride1,
+                           void* plane2, int stride2, long pts) {
+    return rtmp_send_video_frame(plane0, 0, pts);
+}
+
+int rtmp_send_video_region(void* data, int stride, int crop_x, int crop_y,
+                           int crop_width, int crop_height, long pts) {
+    return rtmp_send_video_frame(data, crop_width * crop_height * 4, pts);
+}
+
+typedef void (*release_callback)(void* opaque, const void* data);
+
+int rtmp_submit_video_frame(void* data, int data_size, release_callback release, void* opaque, long pts) {
+    int ret = rtmp_send_video_frame(data, data_size, pts);
+    if (release) {
+        release(opaque, data);
+    }
+    return ret;
+}
+
+void* rtmp_acquire_frame_buffer(int* size) {
+    // Stub - no pool, callers fall back to their own buffers
+    return NULL;
+}
+
+int rtmp_submit_frame_buffer(void* buffer, long pts) {
+    return RTMP_ERROR_NOT_IMPLEMENTED;
+}
+
+int rtmp_release_frame_buffer(void* buffer) {
+    return RTMP_ERROR_NOT_IMPLEMENTED;
+}
+
 int rtmp_send_audio(void* pcm_data, int num_samples, long pts) {
     // Stub - do nothing
     return RTMP_SUCCESS;
 }
 
+int rtmp_set_video_bitrate(int bitrate_kbps) {
+    printf("[RTMP STUB] set_video_bitrate: %dkbps\n", bitrate_kbps);
+    return RTMP_SUCCESS;
+}
+
+int rtmp_request_keyframe(void) {
+    printf("[RTMP STUB] request_keyframe\n");
+    return RTMP_SUCCESS;
+}
+
+int rtmp_set_encoder_option(const char* key, const char* value) {
+    printf("[RTMP STUB] set_encoder_option: %s=%s\n", key ? key : "(null)", value ? value : "(null)");
+    return RTMP_SUCCESS;
+}
+
+int rtmp_probe_video_encoder(void) {
+    printf("[RTMP STUB] probe_video_encoder\n");
+    return RTMP_SUCCESS;
+}
+
+const char* rtmp_get_video_encoder(void) {
+    return "stub";
+}
+
+const char* rtmp_get_encoder_probe(void) {
+    return "stub: ok";
+}
+
+int rtmp_save_replay(const char* path, int seconds) {
+    printf("[RTMP STUB] save_replay: %s, last %ds\n", path ? path : "(null)", seconds);
+    return RTMP_SUCCESS;
+}
+
+int rtmp_start_recording(const char* path) {
+    printf("[RTMP STUB] start_recording: %s\n", path ? path : "(null)");
+    return RTMP_SUCCESS;
+}
+
+int rtmp_stop_recording(void) {
+    printf("[RTMP STUB] stop_recording\n");
+    return RTMP_SUCCESS;
+}
+
+int rtmp_get_recording_state(void) {
+    return 0;  // idle
+}
+
+int rtmp_add_destination(const char* url) {
+    printf("[RTMP STUB] add_destination: %s\n", url ? url : "(null)");
+    return RTMP_SUCCESS;
+}
+
+int rtmp_add_rendition(const char* url, int width, int height, int bitrate_kbps) {
+    printf("[RTMP STUB] add_rendition: %s %dx%d @ %dkbps\n", url ? url : "(null)", width, height, bitrate_kbps);
+    return RTMP_SUCCESS;
+}
+
 int rtmp_stop_streaming(void) {
     printf("[RTMP STUB] stop_streaming\n");
     return RTMP_SUCCESS;
@@ -111,6 +217,180 @@ int rtmp_get_dropped_frames(void) {
     return g_dropped_frames;
 }
 
+int rtmp_get_stats(void* stats) {
+    // Stub - leave the caller's struct untouched
+    return RTMP_ERROR_NOT_IMPLEMENTED;
+}
+
+int rtmp_get_rendition_stats(int index, void* stats) {
+    return rtmp_get_stats(stats);
+}
+
+int rtmp_get_recording_stats(void* stats) {
+    return rtmp_get_stats(stats);
+}
+
+int rtmp_get_destination_state(int index) {
+    return rtmp_get_state();
+}
+
+int rtmp_get_destination_stats(int index, void* stats) {
+    return rtmp_get_stats(stats);
+}
+
+// ==========================================
+// SESSION API (Stub - all sessions share the state above)
+// ==========================================
+
+static int g_stub_session;
+
+void* rtmp_session_create(void) {
+    return &g_stub_session;
+}
+
+void rtmp_session_destroy(void* session) {
+    rtmp_cleanup();
+}
+
+int rtmp_session_init(void* session, const void* config) {
+    return rtmp_init(config);
+}
+
+int rtmp_session_connect(void* session, const char* url) {
+    return rtmp_connect(url);
+}
+
+int rtmp_session_connect_async(void* session, const char* url) {
+    return rtmp_connect_async(url);
+}
+
+int rtmp_session_start_streaming(void* session) {
+    return rtmp_start_streaming();
+}
+
+int rtmp_session_send_video_frame(void* session, void* rgba_data, int data_size, long pts) {
+    return rtmp_send_video_frame(rgba_data, data_size, pts);
+}
+
+int rtmp_session_send_video_planes(void* session, void* plane0, int stride0, void* plane1, int stride1,
+                                   void* plane2, int stride2, long pts) {
+    return rtmp_send_video_planes(plane0, stride0, plane1, stride1, plane2, stride2, pts);
+}
+
+int rtmp_session_send_video_region(void* session, void* data, int stride, int crop_x, int crop_y,
+                                   int crop_width, int crop_height, long pts) {
+    return rtmp_send_video_region(data, stride, crop_x, crop_y, crop_width, crop_height, pts);
+}
+
+int rtmp_session_submit_video_frame(void* session, void* data, int data_size,
+                                    release_callback release, void* opaque, long pts) {
+    return rtmp_submit_video_frame(data, data_size, release, opaque, pts);
+}
+
+void* rtmp_session_acquire_frame_buffer(void* session, int* size) {
+    return rtmp_acquire_frame_buffer(size);
+}
+
+int rtmp_session_submit_frame_buffer(void* session, void* buffer, long pts) {
+    return rtmp_submit_frame_buffer(buffer, pts);
+}
+
+int rtmp_session_release_frame_buffer(void* session, void* buffer) {
+    return rtmp_release_frame_buffer(buffer);
+}
+
+int rtmp_session_send_audio(void* session, void* pcm_data, int num_samples, long pts) {
+    return rtmp_send_audio(pcm_data, num_samples, pts);
+}
+
+int rtmp_session_set_video_bitrate(void* session, int bitrate_kbps) {
+    return rtmp_set_video_bitrate(bitrate_kbps);
+}
+
+int rtmp_session_request_keyframe(void* session) {
+    return rtmp_request_keyframe();
+}
+
+int rtmp_session_set_encoder_option(void* session, const char* key, const char* value) {
+    return rtmp_set_encoder_option(key, value);
+}
+
+int rtmp_session_probe_video_encoder(void* session) {
+    return rtmp_probe_video_encoder();
+}
+
+const char* rtmp_session_get_video_encoder(void* session) {
+    return rtmp_get_video_encoder();
+}
+
+const char* rtmp_session_get_encoder_probe(void* session) {
+    return rtmp_get_encoder_probe();
+}
+
+int rtmp_session_save_replay(void* session, const char* path, int seconds) {
+    return rtmp_save_replay(path, seconds);
+}
+
+int rtmp_session_start_recording(void* session, const char* path) {
+    return rtmp_start_recording(path);
+}
+
+int rtmp_session_stop_recording(void* session) {
+    return rtmp_stop_recording();
+}
+
+int rtmp_session_get_recording_state(void* session) {
+    return rtmp_get_recording_state();
+}
+
+int rtmp_session_get_recording_stats(void* session, void* stats) {
+    return rtmp_get_recording_stats(stats);
+}
+
+int rtmp_session_add_destination(void* session, const char* url) {
+    return rtmp_add_destination(url);
+}
+
+int rtmp_session_get_destination_state(void* session, int index) {
+    return rtmp_get_destination_state(index);
+}
+
+int rtmp_session_get_destination_stats(void* session, int index, void* stats) {
+    return rtmp_get_destination_stats(index, stats);
+}
+
+int rtmp_session_add_rendition(void* session, const char* url, int width, int height, int bitrate_kbps) {
+    return rtmp_add_rendition(url, width, height, bitrate_kbps);
+}
+
+int rtmp_session_get_rendition_stats(void* session, int index, void* stats) {
+    return rtmp_get_rendition_stats(index, stats);
+}
+
+int rtmp_session_stop_streaming(void* session) {
+    return rtmp_stop_streaming();
+}
+
+int rtmp_session_disconnect(void* session) {
+    return rtmp_disconnect();
+}
+
+void rtmp_session_cleanup(void* session) {
+    rtmp_cleanup();
+}
+
+int rtmp_session_get_state(void* session) {
+    return rtmp_get_state();
+}
+
+const char* rtmp_session_get_error(void* session) {
+    return rtmp_get_error();
+}
+
+int rtmp_session_get_stats(void* session, void* stats) {
+    return rtmp_get_stats(stats);
+}
+
 int rtmp_is_stub(void) {
     return 1;
 }